@@ -0,0 +1,78 @@
+#include "Atlas.h"
+
+#include <cassert>
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+
+namespace tlgn {
+
+  namespace {
+
+    struct Shelf {
+      int page;
+      int y;
+      int height;
+      int width; // already used
+    };
+
+  }
+
+  /*
+   * Shelf packing: the tilesets are sorted by decreasing height then width
+   * and each one goes on the first shelf where it fits. As all the
+   * tilesets have the same height, the narrow tilesets fill the end of the
+   * shelves of the wide ones, and the categories share the rows.
+   */
+  bool packAtlas(const std::vector<gf::Vector2i>& sizes, gf::Vector2i pageSize, Atlas& atlas) {
+    atlas.pages = 0;
+    atlas.placements.assign(sizes.size(), { 0, { 0, 0 } });
+
+    std::vector<std::size_t> order(sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+
+    std::stable_sort(order.begin(), order.end(), [&sizes](std::size_t lhs, std::size_t rhs) {
+      if (sizes[lhs].height != sizes[rhs].height) {
+        return sizes[lhs].height > sizes[rhs].height;
+      }
+
+      return sizes[lhs].width > sizes[rhs].width;
+    });
+
+    std::vector<Shelf> shelves;
+    int pageHeight = 0; // used on the last page
+
+    for (auto index : order) {
+      gf::Vector2i size = sizes[index];
+
+      if (size.width > pageSize.width || size.height > pageSize.height) {
+        std::cerr << "The page is too small for a tileset of " << size.width << 'x' << size.height << " tiles\n";
+        atlas.pages = 0;
+        atlas.placements.clear();
+        return false;
+      }
+
+      auto it = std::find_if(shelves.begin(), shelves.end(), [size, pageSize](const Shelf& shelf) {
+        return shelf.height >= size.height && shelf.width + size.width <= pageSize.width;
+      });
+
+      if (it == shelves.end()) {
+        if (atlas.pages == 0 || pageHeight + size.height > pageSize.height) {
+          ++atlas.pages;
+          pageHeight = 0;
+        }
+
+        shelves.push_back({ atlas.pages - 1, pageHeight, size.height, 0 });
+        pageHeight += size.height;
+        it = std::prev(shelves.end());
+      }
+
+      atlas.placements[index] = { it->page, { it->width, it->y } };
+      it->width += size.width;
+    }
+
+    return true;
+  }
+
+}
@@ -0,0 +1,25 @@
+#ifndef TILEGEN_ATLAS_H
+#define TILEGEN_ATLAS_H
+
+#include <vector>
+
+#include <gf/Vector.h>
+
+namespace tlgn {
+
+  struct AtlasPlacement {
+    int page;
+    gf::Vector2i position; // in tiles
+  };
+
+  struct Atlas {
+    int pages = 0;
+    std::vector<AtlasPlacement> placements; // in the order of the tilesets
+  };
+
+  // packs the tilesets, of the given sizes in tiles, on pages of the given size in tiles
+  bool packAtlas(const std::vector<gf::Vector2i>& sizes, gf::Vector2i pageSize, Atlas& atlas);
+
+}
+
+#endif // TILEGEN_ATLAS_H
@@ -7,7 +7,6 @@
 #include <vector>
 
 #include <gf/Id.h>
-#include <gf/Random.h>
 #include <gf/Vector.h>
 
 using namespace gf::literals;
@@ -33,7 +32,8 @@ namespace tlgn {
       } randomize;
     };
 
-    gf::Color4f getColor(gf::Random& random, gf::Vector2i pos) const;
+    // the stripes of a Striped pigment, the colors of the tiles are computed in Colorize.cc
+    static bool isInStripe(gf::Vector2i pos);
   };
 
   struct Biome {
@@ -51,15 +51,21 @@ namespace tlgn {
     Blur,
   };
 
+  enum class DistanceMetric {
+    Manhattan,
+    Euclidean,
+  };
+
   struct Border {
     BorderEffect effect;
+    DistanceMetric metric;
     gf::Id b1;
     gf::Id b2;
   };
 
   struct Frontier {
     int offset = 0;
-    Border border = { BorderEffect::None, gf::InvalidId, gf::InvalidId };
+    Border border = { BorderEffect::None, DistanceMetric::Manhattan, gf::InvalidId, gf::InvalidId };
     bool fence = false;
 
     Frontier inverse() const {
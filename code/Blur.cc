@@ -0,0 +1,123 @@
+#include "Blur.h"
+
+#include <cassert>
+#include <algorithm>
+
+#include <gf/VectorOps.h>
+
+#include "Scratch.h"
+
+namespace tlgn {
+
+  namespace {
+
+    static_assert(sizeof(gf::Color4f) == 4 * sizeof(float), "Colors must be packed floats");
+
+    constexpr int Channels = 4;
+    constexpr int Radius = 2;
+    constexpr float Weights[2 * Radius + 1] = { 1.0f, 4.0f, 6.0f, 4.0f, 1.0f };
+
+    const float *getRow(const Colors& colors, int y) {
+      return reinterpret_cast<const float *>(&colors({ 0, y }));
+    }
+
+    float *getRow(Colors& colors, int y) {
+      return reinterpret_cast<float *>(&colors({ 0, y }));
+    }
+
+    // the kernel is clipped at the edges, so the weights are normalized by the sum of the weights inside
+    float computeWeightSum(int i, int count) {
+      float sum = 0.0f;
+
+      for (int k = -Radius; k <= Radius; ++k) {
+        if (i + k >= 0 && i + k < count) {
+          sum += Weights[k + Radius];
+        }
+      }
+
+      return sum;
+    }
+
+    void blurRowEdge(const float *src, int x, int width, float *dst) {
+      float sum = computeWeightSum(x, width);
+
+      for (int c = 0; c < Channels; ++c) {
+        float value = 0.0f;
+
+        for (int k = -Radius; k <= Radius; ++k) {
+          if (x + k >= 0 && x + k < width) {
+            value += Weights[k + Radius] * src[(x + k) * Channels + c];
+          }
+        }
+
+        dst[x * Channels + c] = value / sum;
+      }
+    }
+
+    void blurRow(const float *src, int width, float *dst) {
+      // interior, the channels of consecutive pixels are independent so the loop is vectorized
+      const int begin = Radius * Channels;
+      const int end = (width - Radius) * Channels;
+
+      for (int i = begin; i < end; ++i) {
+        dst[i] = (src[i - 2 * Channels] + 4.0f * src[i - Channels] + 6.0f * src[i] + 4.0f * src[i + Channels] + src[i + 2 * Channels]) * (1.0f / 16.0f);
+      }
+
+      for (int x = 0; x < std::min(Radius, width); ++x) {
+        blurRowEdge(src, x, width, dst);
+      }
+
+      for (int x = std::max(Radius, width - Radius); x < width; ++x) {
+        blurRowEdge(src, x, width, dst);
+      }
+    }
+
+  }
+
+  /*
+   * The 5x5 kernel is the outer product of 1-4-6-4-1 with itself, so it is
+   * applied as a horizontal pass followed by a vertical pass. The clipped
+   * kernel is still an outer product, so normalizing each pass gives the same
+   * result as normalizing the 2D kernel.
+   */
+  void blurColors(const Colors& colors, int ymin, int ymax, Colors& blurred) {
+    auto size = colors.getSize();
+    assert(blurred.getSize() == size);
+    assert(0 <= ymin && ymin <= ymax && ymax < size.height);
+
+    const int width = size.width * Channels;
+
+    Colors& rows = Scratch::getLocal().getBlurRows(size);
+
+    int ybegin = std::max(ymin - Radius, 0);
+    int yend = std::min(ymax + Radius, size.height - 1);
+
+    for (int y = ybegin; y <= yend; ++y) {
+      blurRow(getRow(colors, y), size.width, getRow(rows, y));
+    }
+
+    for (int y = ymin; y <= ymax; ++y) {
+      const float *src[2 * Radius + 1];
+
+      for (int k = -Radius; k <= Radius; ++k) {
+        // rows outside the array have a null weight, any valid row does the job
+        int row = std::min(std::max(y + k, 0), size.height - 1);
+        src[k + Radius] = getRow(rows, row);
+      }
+
+      float factors[2 * Radius + 1];
+      float sum = computeWeightSum(y, size.height);
+
+      for (int k = -Radius; k <= Radius; ++k) {
+        factors[k + Radius] = (y + k >= 0 && y + k < size.height) ? Weights[k + Radius] / sum : 0.0f;
+      }
+
+      float *dst = getRow(blurred, y);
+
+      for (int i = 0; i < width; ++i) {
+        dst[i] = factors[0] * src[0][i] + factors[1] * src[1][i] + factors[2] * src[2][i] + factors[3] * src[3][i] + factors[4] * src[4][i];
+      }
+    }
+  }
+
+}
@@ -0,0 +1,13 @@
+#ifndef TILEGEN_BLUR_H
+#define TILEGEN_BLUR_H
+
+#include "Tile.h"
+
+namespace tlgn {
+
+  // blur with the 5x5 binomial kernel, only the rows [ymin, ymax] of blurred are computed
+  void blurColors(const Colors& colors, int ymin, int ymax, Colors& blurred);
+
+}
+
+#endif // TILEGEN_BLUR_H
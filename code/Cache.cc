@@ -0,0 +1,276 @@
+#include "Cache.h"
+
+#include <cstdio>
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+
+namespace tlgn {
+
+  namespace {
+
+    // to change whenever the generation or the file format changes
+    constexpr uint32_t CacheVersion = 2;
+    constexpr char CacheMagic[4] = { 'T', 'L', 'G', 'N' };
+
+    class KeyWriter {
+    public:
+      template<typename T>
+      void write(const T& value) {
+        m_data.append(reinterpret_cast<const char *>(&value), sizeof(T));
+      }
+
+      void writePigment(const Pigment& pigment) {
+        write(pigment.color);
+        write(static_cast<int32_t>(pigment.style));
+
+        if (pigment.style == PigmentStyle::Randomize) {
+          write(pigment.randomize.ratio);
+          write(pigment.randomize.deviation);
+        }
+      }
+
+      void writeFrontier(const Frontier& frontier) {
+        write(static_cast<int32_t>(frontier.offset));
+        write(static_cast<int32_t>(frontier.border.effect));
+        write(static_cast<int32_t>(frontier.border.metric));
+        write(frontier.border.b1);
+        write(frontier.border.b2);
+        write(static_cast<uint8_t>(frontier.fence));
+      }
+
+      std::string& getData() {
+        return m_data;
+      }
+
+    private:
+      std::string m_data;
+    };
+
+    uint64_t computeHash(const std::string& data) {
+      // FNV-1a
+      uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+      for (char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= UINT64_C(0x100000001b3);
+      }
+
+      return hash;
+    }
+
+    template<typename T>
+    void writeValue(std::ostream& os, const T& value) {
+      os.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool readValue(std::istream& is, T& value) {
+      return static_cast<bool>(is.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+  }
+
+  CacheKey computeCacheKey(const TilesetPlan& plan, const Database& db) {
+    KeyWriter writer;
+
+    writer.write(CacheVersion);
+    writer.write(static_cast<int32_t>(db.settings.tile.size));
+    writer.write(static_cast<int32_t>(db.settings.tile.spacing));
+    writer.write(plan.seed.seed);
+    writer.write(static_cast<uint64_t>(plan.seed.category));
+    writer.write(static_cast<uint64_t>(plan.seed.index));
+
+    for (auto biome : plan.biomes) {
+      writer.write(biome);
+
+      int index = db.getCompiled().intern(biome);
+
+      if (index != CompiledDatabase::InvalidBiome) {
+        const Pigment *pigment = db.getCompiled().getPigment(index);
+
+        if (pigment != nullptr) {
+          writer.writePigment(*pigment);
+        }
+      }
+    }
+
+    switch (plan.seed.category) {
+      case SeedCategory::Plain:
+        break;
+
+      case SeedCategory::TwoCorners:
+      case SeedCategory::Overlay:
+        writer.writeFrontier(db.getFrontier(plan.biomes[0], plan.biomes[1]));
+        break;
+
+      case SeedCategory::ThreeCorners:
+        writer.writeFrontier(db.getFrontier(plan.biomes[0], plan.biomes[1]));
+        writer.writeFrontier(db.getFrontier(plan.biomes[1], plan.biomes[2]));
+        writer.writeFrontier(db.getFrontier(plan.biomes[2], plan.biomes[0]));
+        break;
+    }
+
+    CacheKey key;
+    key.data = std::move(writer.getData());
+    key.hash = computeHash(key.data);
+    return key;
+  }
+
+  TileCache::TileCache(const gf::Path& directory)
+  : m_directory(directory)
+  , m_enabled(!directory.empty())
+  , m_hits(0)
+  , m_misses(0)
+  {
+    if (!m_enabled) {
+      return;
+    }
+
+    boost::system::error_code error;
+    boost::filesystem::create_directories(m_directory, error);
+
+    if (error) {
+      std::cerr << "Could not create the cache directory: " << m_directory.string() << '\n';
+      m_enabled = false;
+    }
+  }
+
+  bool TileCache::load(const CacheKey& key, Tileset& tileset) {
+    if (!m_enabled) {
+      return false;
+    }
+
+    std::ifstream is(getFilename(key).string(), std::ios::binary);
+
+    auto miss = [this]() {
+      ++m_misses;
+      return false;
+    };
+
+    if (!is) {
+      return miss();
+    }
+
+    char magic[4];
+    uint32_t version;
+    uint32_t keySize;
+
+    if (!readValue(is, magic) || !std::equal(std::begin(magic), std::end(magic), std::begin(CacheMagic)) || !readValue(is, version) || version != CacheVersion || !readValue(is, keySize) || keySize != key.data.size()) {
+      return miss();
+    }
+
+    std::string data(keySize, '\0');
+
+    if (!is.read(&data[0], keySize) || data != key.data) {
+      return miss();
+    }
+
+    gf::Vector2i tilesetSize;
+
+    if (!readValue(is, tilesetSize)) {
+      return miss();
+    }
+
+    Tileset loaded(tilesetSize, gf::None);
+
+    for (auto& tile : loaded) {
+      int32_t size, spacing, orientation, fences;
+
+      if (!readValue(is, size) || !readValue(is, spacing) || !readValue(is, orientation) || !readValue(is, tile.terrain) || !readValue(is, fences) || fences < 0 || fences > 2) {
+        return miss();
+      }
+
+      tile.size = size;
+      tile.spacing = spacing;
+      tile.orientation = orientation;
+      tile.fences.count = fences;
+
+      for (int i = 0; i < fences; ++i) {
+        int32_t d1, d2;
+
+        if (!readValue(is, d1) || !readValue(is, d2)) {
+          return miss();
+        }
+
+        tile.fences.fence[i].d1 = static_cast<gf::Direction>(d1);
+        tile.fences.fence[i].d2 = static_cast<gf::Direction>(d2);
+      }
+
+      int extent = size + 2 * spacing;
+      tile.texels = Texels({ extent, extent });
+
+      if (!is.read(reinterpret_cast<char *>(tile.texels.begin()), tile.texels.getDataSize() * sizeof(gf::Color4u))) {
+        return miss();
+      }
+    }
+
+    tileset = std::move(loaded);
+    ++m_hits;
+    return true;
+  }
+
+  void TileCache::save(const CacheKey& key, const Tileset& tileset) {
+    if (!m_enabled) {
+      return;
+    }
+
+    // written in a temporary file first, so that a concurrent run never reads a partial file
+    // the name is random, two runs that save the same key do not share their temporary file
+    gf::Path filename = getFilename(key);
+    gf::Path temporary = boost::filesystem::unique_path(filename.string() + ".%%%%-%%%%-%%%%-%%%%.tmp");
+
+    {
+      std::ofstream os(temporary.string(), std::ios::binary);
+
+      writeValue(os, CacheMagic);
+      writeValue(os, CacheVersion);
+      writeValue(os, static_cast<uint32_t>(key.data.size()));
+      os.write(key.data.data(), key.data.size());
+      writeValue(os, tileset.getSize());
+
+      for (auto& tile : tileset) {
+        writeValue(os, static_cast<int32_t>(tile.size));
+        writeValue(os, static_cast<int32_t>(tile.spacing));
+        writeValue(os, static_cast<int32_t>(tile.orientation));
+        writeValue(os, tile.terrain);
+        writeValue(os, static_cast<int32_t>(tile.fences.count));
+
+        for (int i = 0; i < tile.fences.count; ++i) {
+          writeValue(os, static_cast<int32_t>(tile.fences.fence[i].d1));
+          writeValue(os, static_cast<int32_t>(tile.fences.fence[i].d2));
+        }
+
+        os.write(reinterpret_cast<const char *>(tile.texels.getDataPtr()), tile.texels.getDataSize() * sizeof(gf::Color4u));
+      }
+
+      if (!os) {
+        std::cerr << "Could not write the cache file: " << temporary.string() << '\n';
+        os.close();
+        std::remove(temporary.string().c_str());
+        return;
+      }
+    }
+
+    std::rename(temporary.string().c_str(), filename.string().c_str());
+  }
+
+  CacheStats TileCache::getStats() const {
+    return { m_hits.load(), m_misses.load() };
+  }
+
+  gf::Path TileCache::getFilename(const CacheKey& key) const {
+    static constexpr char Digits[] = "0123456789abcdef";
+    std::string name(16, '0');
+
+    for (int i = 0; i < 16; ++i) {
+      name[15 - i] = Digits[(key.hash >> (4 * i)) & 0xF];
+    }
+
+    return m_directory / (name + ".tile");
+  }
+
+}
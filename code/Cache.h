@@ -0,0 +1,60 @@
+#ifndef TILEGEN_CACHE_H
+#define TILEGEN_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+#include <gf/Path.h>
+
+#include "Database.h"
+#include "Plan.h"
+#include "Tileset.h"
+
+namespace tlgn {
+
+  // everything that affects a tileset, serialized; the hash names the cache file
+  struct CacheKey {
+    std::string data;
+    uint64_t hash;
+  };
+
+  CacheKey computeCacheKey(const TilesetPlan& plan, const Database& db);
+
+  struct CacheStats {
+    std::size_t hits;
+    std::size_t misses;
+  };
+
+  /*
+   * On-disk cache of colorized tilesets, one file per tileset. The file
+   * stores the full key, so a hash collision is detected and counted as a
+   * miss. The cache is disabled if the directory is empty.
+   */
+  class TileCache {
+  public:
+    explicit TileCache(const gf::Path& directory);
+
+    bool isEnabled() const {
+      return m_enabled;
+    }
+
+    bool load(const CacheKey& key, Tileset& tileset);
+    void save(const CacheKey& key, const Tileset& tileset);
+
+    CacheStats getStats() const;
+
+  private:
+    gf::Path getFilename(const CacheKey& key) const;
+
+  private:
+    gf::Path m_directory;
+    bool m_enabled;
+    std::atomic<std::size_t> m_hits;
+    std::atomic<std::size_t> m_misses;
+  };
+
+}
+
+#endif // TILEGEN_CACHE_H
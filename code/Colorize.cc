@@ -0,0 +1,200 @@
+#include "Colorize.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+
+#include <gf/Color.h>
+#include <gf/Math.h>
+#include <gf/VectorOps.h>
+
+#include "Scratch.h"
+
+namespace tlgn {
+
+  namespace {
+
+    /*
+     * The kernels write count colors, from out with the given stride
+     */
+
+    void fillRun(gf::Color4f *out, std::ptrdiff_t stride, int count, gf::Color4f color) {
+      if (stride == 1) {
+        std::fill_n(out, count, color);
+        return;
+      }
+
+      for (int i = 0; i < count; ++i, out += stride) {
+        *out = color;
+      }
+    }
+
+    void stripeRun(gf::Color4f *out, std::ptrdiff_t stride, int count, const uint8_t *mask, const ColorEntry& entry) {
+      for (int i = 0; i < count; ++i, out += stride) {
+        *out = mask[i] ? entry.color : entry.offColor;
+      }
+    }
+
+    constexpr int RandomizeBatch = 16;
+
+    // the 32-bit integer hash "lowbias32" by Chris Wellons
+    inline uint32_t hashPixel(uint32_t x) {
+      x ^= x >> 16;
+      x *= UINT32_C(0x7FEB352D);
+      x ^= x >> 15;
+      x *= UINT32_C(0x846CA68B);
+      x ^= x >> 16;
+      return x;
+    }
+
+    /*
+     * Each pixel gets two hashes of (key, counter): a Bernoulli draw on 24
+     * bits and four uniform numbers on 8 bits. The sum of the four uniform
+     * numbers is an approximation of a normal deviate (Irwin-Hall): it stays
+     * in [-3.46, 3.46] standard deviations and its CDF is within 0.008 of the
+     * normal CDF, far below what is visible after the quantization.
+     *
+     * The loop has a fixed count, no branch and no call, so that it is
+     * vectorized at -O2. A batch may compute more pixels than needed.
+     */
+    void computeRandomizeFactors(const ColorEntry& entry, uint32_t key, uint32_t counter, float *factors) {
+      const int32_t threshold = entry.threshold;
+      const float deviationScale = entry.deviationScale;
+      const float maxFactor = entry.maxFactor;
+
+      for (int i = 0; i < RandomizeBatch; ++i) {
+        uint32_t state = key + (counter + i) * UINT32_C(0x9E3779B9);
+        uint32_t bernoulli = hashPixel(state);
+        uint32_t normal = hashPixel(state ^ UINT32_C(0x5BD1E995));
+
+        int32_t sum = static_cast<int32_t>((normal & 0xFF) + ((normal >> 8) & 0xFF) + ((normal >> 16) & 0xFF) + (normal >> 24));
+        float change = static_cast<float>(sum - 510) * deviationScale;
+        change = change < -0.5f ? -0.5f : change;
+        change = change > 0.5f ? 0.5f : change;
+
+        int32_t chosen = static_cast<int32_t>(bernoulli >> 8) < threshold;
+        float factor = 1.0f - change * static_cast<float>(chosen);
+        factors[i] = factor < maxFactor ? factor : maxFactor;
+      }
+    }
+
+    /*
+     * darker() and lighter() scale the value of the color in HSV, with the
+     * same hue and saturation. This is a scale of the RGB components, by
+     * (1 - change), as long as the value does not go above 1.
+     */
+    void randomizeRun(gf::Color4f *out, std::ptrdiff_t stride, int count, const ColorEntry& entry, uint32_t key, uint32_t counter) {
+      float factors[RandomizeBatch];
+
+      for (int first = 0; first < count; first += RandomizeBatch) {
+        int batch = std::min(count - first, RandomizeBatch);
+        computeRandomizeFactors(entry, key, counter + first, factors);
+
+        for (int i = 0; i < batch; ++i, out += stride) {
+          float factor = factors[i];
+          *out = gf::Color4f(entry.color.r * factor, entry.color.g * factor, entry.color.b * factor, entry.color.a);
+        }
+      }
+    }
+
+  }
+
+  ColorTable computeColorTable(const Palette& palette, const Database& db) {
+    ColorTable table;
+    table.count = palette.count;
+
+    for (int i = 0; i < palette.count; ++i) {
+      gf::Id id = palette.biome[i];
+      const Pigment *pigment = db.getPigment(id);
+      assert(pigment != nullptr || id == Void);
+
+      ColorEntry& entry = table.entries[i];
+      entry.threshold = 0;
+      entry.deviationScale = 0.0f;
+      entry.maxFactor = 1.0f;
+
+      if (pigment == nullptr) {
+        entry.style = PigmentStyle::Plain;
+        entry.transparent = true;
+        entry.color = entry.offColor = gf::Color4f(1.0f, 1.0f, 1.0f, 0.0f);
+        continue;
+      }
+
+      entry.style = pigment->style;
+      entry.transparent = false;
+      entry.color = pigment->color;
+      entry.offColor = pigment->color * gf::Color::Opaque(0.0f);
+
+      if (pigment->style == PigmentStyle::Randomize) {
+        double ratio = gf::clamp(pigment->randomize.ratio, 0.0, 1.0);
+        entry.threshold = static_cast<int32_t>(ratio * (1 << 24));
+        entry.deviationScale = pigment->randomize.deviation * std::sqrt(3.0f) / 256.0f;
+        float value = std::max({ pigment->color.r, pigment->color.g, pigment->color.b });
+        entry.maxFactor = value > 0.0f ? 1.0f / value : std::numeric_limits<float>::max();
+      }
+    }
+
+    return table;
+  }
+
+  uint32_t computeColorKey(const ColorTable& table, gf::Random& random) {
+    for (int i = 0; i < table.count; ++i) {
+      if (!table.entries[i].transparent && table.entries[i].style == PigmentStyle::Randomize) {
+        return random.computeUniformInteger<uint32_t>(0, UINT32_MAX);
+      }
+    }
+
+    // the other tiles keep their random stream
+    return 0;
+  }
+
+  void colorizeRow(const Pixels& pixels, int row, int orientation, int spacing, const ColorTable& table, uint32_t key, Colors& colors) {
+    const int size = pixels.getSize().width;
+    const gf::Vector2i step = computeCanonicalStep(orientation);
+    const std::ptrdiff_t pixelStride = step.x + step.y * size;
+    const std::ptrdiff_t colorStride = step.x + step.y * colors.getSize().width;
+    const uint8_t *stripes = &Scratch::getLocal().getStripes(size)[row * size];
+
+    gf::Vector2i start = computeCanonicalPosition({ 0, row }, size, orientation);
+    const PaletteIndex *in = &pixels(start);
+    gf::Color4f *out = &colors(start + spacing);
+
+    for (int i = 0; i < size; ) {
+      PaletteIndex index = in[i * pixelStride];
+      assert(index < table.count);
+
+      int end = i + 1;
+
+      while (end < size && in[end * pixelStride] == index) {
+        ++end;
+      }
+
+      const ColorEntry& entry = table.entries[index];
+      gf::Color4f *runOut = out + i * colorStride;
+      int count = end - i;
+
+      if (entry.transparent) {
+        fillRun(runOut, colorStride, count, entry.color);
+      } else {
+        switch (entry.style) {
+          case PigmentStyle::Plain:
+            fillRun(runOut, colorStride, count, entry.color);
+            break;
+
+          case PigmentStyle::Randomize:
+            randomizeRun(runOut, colorStride, count, entry, key, static_cast<uint32_t>(row * size + i));
+            break;
+
+          case PigmentStyle::Striped:
+            stripeRun(runOut, colorStride, count, stripes + i, entry);
+            break;
+        }
+      }
+
+      i = end;
+    }
+  }
+
+}
@@ -0,0 +1,47 @@
+#ifndef TILEGEN_COLORIZE_H
+#define TILEGEN_COLORIZE_H
+
+#include <cstdint>
+
+#include <gf/Random.h>
+
+#include "Biomes.h"
+#include "Tile.h"
+
+namespace tlgn {
+
+  // the colors of a biome of a tile, resolved once for the tile
+  struct ColorEntry {
+    PigmentStyle style;
+    bool transparent; // Void
+    gf::Color4f color;
+    gf::Color4f offColor; // outside the stripes
+    // Randomize
+    int32_t threshold; // of the Bernoulli draw, on 24 bits
+    float deviationScale;
+    float maxFactor; // the brightness can not go above 1
+  };
+
+  struct ColorTable {
+    int count = 0;
+    ColorEntry entries[4];
+  };
+
+  // one entry per biome of the palette, Void has no pigment
+  ColorTable computeColorTable(const Palette& palette, const Database& db);
+
+  // drawn once per tile, only if a biome of the tile is randomized
+  uint32_t computeColorKey(const ColorTable& table, gf::Random& random);
+
+  /*
+   * Colorizes a row of pixels of a tile, in the final orientation. The row
+   * is cut in runs of the same biome and each run goes to the kernel of its
+   * style. The randomized pixels do not draw from the random engine one by
+   * one: each pixel gets its own counter-based hash of the key of the tile,
+   * so that a whole run can be computed in batch.
+   */
+  void colorizeRow(const Pixels& pixels, int row, int orientation, int spacing, const ColorTable& table, uint32_t key, Colors& colors);
+
+}
+
+#endif // TILEGEN_COLORIZE_H
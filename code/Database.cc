@@ -1,8 +1,16 @@
 #include "Database.h"
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
 #include <nlohmann/json.hpp>
 
 #include <gf/Color.h>
+#include <gf/VectorOps.h>
+
+#include "Seed.h"
 
 namespace tlgn {
 
@@ -29,6 +37,19 @@ namespace tlgn {
       return BorderEffect::None;
     }
 
+    DistanceMetric parseDistanceMetric(const std::string& metric) {
+      if (metric == "manhattan") {
+        return DistanceMetric::Manhattan;
+      }
+
+      if (metric == "euclidean") {
+        return DistanceMetric::Euclidean;
+      }
+
+      std::cerr << "Unknown distance metric attribute: " << metric << '\n';
+      return DistanceMetric::Manhattan;
+    }
+
     Frontier parseFrontier(nlohmann::json value) {
       Frontier frontier;
 
@@ -36,6 +57,10 @@ namespace tlgn {
 
       if (value.count("border") == 1) {
         frontier.border.effect = parseBorderEffect(value["border"]["effect"].get<std::string>());
+
+        if (value["border"].count("metric") == 1) {
+          frontier.border.metric = parseDistanceMetric(value["border"]["metric"].get<std::string>());
+        }
       }
 
       frontier.fence = value.count("fence") == 1 && value["fence"].get<bool>();
@@ -62,50 +87,112 @@ namespace tlgn {
 
   }
 
-  Frontier Database::getFrontier(gf::Id b1, gf::Id b2) const {
-    if (b1 == Void || b2 == Void) {
-      for (auto& overlay : overlays) {
-        if (overlay.b0 == b1) {
-          return overlay.frontier;
-        }
+  constexpr int CompiledDatabase::InvalidBiome;
 
-        if (overlay.b0 == b2) {
-          return overlay.frontier.inverse();
-        }
+  void CompiledDatabase::compile(const std::map<gf::Id, Biome>& biomes, const std::vector<BiomeDuo>& duos, const std::vector<BiomeOverlay>& overlays) {
+    m_indices.clear();
+    m_pigments.clear();
+    m_terrainIndices.clear();
+    m_terrainCount = 0;
+
+    for (auto& pair : biomes) {
+      m_indices.insert({ pair.first, static_cast<int>(m_pigments.size()) });
+      m_pigments.push_back(pair.second.pigment);
+      m_terrainIndices.push_back(pair.second.index);
+      m_terrainCount = std::max(m_terrainCount, pair.second.index + 1);
+    }
+
+    m_voidBiome = static_cast<int>(m_pigments.size());
+    m_indices.insert({ Void, m_voidBiome });
+    m_terrainIndices.push_back(-1);
+
+    m_stride = static_cast<std::size_t>(m_voidBiome) + 1;
+    m_frontiers.assign(m_stride * m_stride, Frontier());
+
+    // the first definition of a pair wins, like the previous linear search
+    std::vector<bool> defined(m_frontiers.size(), false);
+
+    auto define = [&](int b1, int b2, const Frontier& frontier) {
+      if (b1 == InvalidBiome || b2 == InvalidBiome) {
+        return;
       }
-    } else {
-      for (auto& duo : duos) {
-        if (duo.b1 == b1 && duo.b2 == b2) {
-          return duo.frontier;
-        }
 
-        if (duo.b1 == b2 && duo.b2 == b1) {
-          return duo.frontier.inverse();
-        }
+      std::size_t index = b1 * m_stride + b2;
+
+      if (!defined[index]) {
+        m_frontiers[index] = frontier;
+        defined[index] = true;
       }
+    };
+
+    for (auto& duo : duos) {
+      int b1 = intern(duo.b1);
+      int b2 = intern(duo.b2);
+
+      if (b1 == m_voidBiome || b2 == m_voidBiome) {
+        continue;
+      }
+
+      define(b1, b2, duo.frontier);
+      define(b2, b1, duo.frontier.inverse());
+    }
+
+    for (auto& overlay : overlays) {
+      int b0 = intern(overlay.b0);
+      define(b0, m_voidBiome, overlay.frontier);
+      define(m_voidBiome, b0, overlay.frontier.inverse());
     }
+  }
+
+  Frontier Database::getFrontier(gf::Id b1, gf::Id b2) const {
+    int i1 = compiled.intern(b1);
+    int i2 = compiled.intern(b2);
 
-    return Frontier();
+    if (i1 == CompiledDatabase::InvalidBiome || i2 == CompiledDatabase::InvalidBiome) {
+      return Frontier();
+    }
+
+    return compiled.getFrontier(i1, i2);
   }
 
   int Database::getIndex(gf::Id biome) const {
-    if (biome == Void) {
+    int index = compiled.intern(biome);
+
+    if (index == CompiledDatabase::InvalidBiome) {
+      std::cerr << "Unknown biome id: " << biome << '\n';
       return -1;
     }
 
-    auto it = biomes.find(biome);
+    return compiled.getTerrainIndex(index);
+  }
+
+  const Pigment *Database::getPigment(gf::Id biome) const {
+    int index = compiled.intern(biome);
 
-    if (it == biomes.end()) {
+    if (index == CompiledDatabase::InvalidBiome) {
       std::cerr << "Unknown biome id: " << biome << '\n';
-      return -1;
+      return nullptr;
     }
 
-    return it->second.index;
+    return compiled.getPigment(index);
+  }
+
+  void Database::compile() {
+    compiled.compile(biomes, duos, overlays);
   }
 
   Database Database::load(const gf::Path& filename) {
     std::ifstream ifs(filename.string());
-    const auto j = nlohmann::json::parse(ifs);
+    return load(ifs);
+  }
+
+  Database Database::parse(const std::string& text) {
+    std::istringstream iss(text);
+    return load(iss);
+  }
+
+  Database Database::load(std::istream& is) {
+    const auto j = nlohmann::json::parse(is);
 
     Database db;
 
@@ -119,6 +206,18 @@ namespace tlgn {
     db.settings.image = gf::Vector2i(image[0], image[1]);
     assert(db.settings.image.width > 0 && db.settings.image.height > 0);
 
+    if (j["settings"].count("page") == 1) {
+      auto page = j["settings"]["page"];
+      db.settings.page = gf::Vector2i(page[0], page[1]);
+
+      // a page must hold the largest tileset, 9x4 tiles
+      gf::Vector2i largest = getTilesetSize(SeedCategory::ThreeCorners) * db.settings.tile.getExtendedSize();
+
+      if (db.settings.page.width < largest.width || db.settings.page.height < largest.height) {
+        throw std::invalid_argument("the page " + std::to_string(db.settings.page.width) + 'x' + std::to_string(db.settings.page.height) + " can not hold a tileset of " + std::to_string(largest.width) + 'x' + std::to_string(largest.height));
+      }
+    }
+
     for (auto kv : j["biomes"].items()) {
       Biome biome;
       biome.index = std::stoi(kv.key());
@@ -149,6 +248,19 @@ namespace tlgn {
       db.biomes.insert({ biome.id, biome });
     }
 
+    // the indices are the terrains of the TSX, in order
+    std::vector<bool> indices(db.biomes.size(), false);
+
+    for (auto& pair : db.biomes) {
+      int index = pair.second.index;
+
+      if (index < 0 || static_cast<std::size_t>(index) >= indices.size() || indices[index]) {
+        throw std::invalid_argument("the biome indices must go from 0 to " + std::to_string(db.biomes.size() - 1) + " without a gap, found " + std::to_string(index));
+      }
+
+      indices[index] = true;
+    }
+
     auto check = [&db](const std::string& name) {
       gf::Id id = gf::hash(name);
 
@@ -206,6 +318,7 @@ namespace tlgn {
       db.overlays.push_back(overlay);
     }
 
+    db.compile();
     return db;
   }
 
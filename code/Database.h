@@ -1,6 +1,12 @@
 #ifndef TILEGEN_DATABASE_H
 #define TILEGEN_DATABASE_H
 
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include <gf/Id.h>
 #include <gf/Path.h>
 
@@ -9,6 +15,52 @@
 
 namespace tlgn {
 
+  /*
+   * The biomes interned to dense indices, Void being the last one, with flat
+   * tables for the frontiers (inverses included) and the pigments. It is
+   * built once and only read afterwards, so it can be shared by all the
+   * threads.
+   */
+  class CompiledDatabase {
+  public:
+    void compile(const std::map<gf::Id, Biome>& biomes, const std::vector<BiomeDuo>& duos, const std::vector<BiomeOverlay>& overlays);
+
+    static constexpr int InvalidBiome = -1;
+
+    // the dense index of a biome, InvalidBiome if it is unknown
+    int intern(gf::Id biome) const {
+      auto it = m_indices.find(biome);
+      return it != m_indices.end() ? it->second : InvalidBiome;
+    }
+
+    const Frontier& getFrontier(int b1, int b2) const {
+      return m_frontiers[b1 * m_stride + b2];
+    }
+
+    // nullptr for Void
+    const Pigment *getPigment(int biome) const {
+      return biome < m_voidBiome ? &m_pigments[biome] : nullptr;
+    }
+
+    int getTerrainIndex(int biome) const {
+      return m_terrainIndices[biome];
+    }
+
+    // one more than the largest terrain index, the size of a table indexed by terrain
+    int getTerrainCount() const {
+      return m_terrainCount;
+    }
+
+  private:
+    std::unordered_map<gf::Id, int> m_indices;
+    int m_voidBiome = 0;
+    std::size_t m_stride = 0;
+    std::vector<Frontier> m_frontiers;
+    std::vector<Pigment> m_pigments;
+    std::vector<int> m_terrainIndices;
+    int m_terrainCount = 0;
+  };
+
   struct Database {
     Settings settings;
 
@@ -19,8 +71,23 @@ namespace tlgn {
 
     Frontier getFrontier(gf::Id b1, gf::Id b2) const;
     int getIndex(gf::Id biome) const;
+    // nullptr for Void
+    const Pigment *getPigment(gf::Id biome) const;
+
+    // to call after any modification of the biomes, duos or overlays (load, the pipeline and the tile provider do it)
+    void compile();
+
+    const CompiledDatabase& getCompiled() const {
+      return compiled;
+    }
 
     static Database load(const gf::Path& filename);
+    static Database load(std::istream& is);
+    // the JSON text of a file
+    static Database parse(const std::string& text);
+
+  private:
+    CompiledDatabase compiled;
   };
 
 }
@@ -0,0 +1,170 @@
+#include "Distance.h"
+
+#include <cassert>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#include <gf/VectorOps.h>
+
+#include "Scratch.h"
+
+namespace tlgn {
+
+  namespace {
+
+    /*
+     * Exact Manhattan distance in two passes: the first pass propagates the
+     * distances from the top left, the second one from the bottom right.
+     */
+    void computeManhattanDistances(const Pixels& pixels, PaletteIndex target, Distances& distances) {
+      auto size = pixels.getSize();
+      const float infinity = static_cast<float>(size.width + size.height);
+
+      for (int y = 0; y < size.height; ++y) {
+        const PaletteIndex *row = &pixels({ 0, y });
+        float *curr = &distances({ 0, y });
+        const float *prev = y > 0 ? &distances({ 0, y - 1 }) : nullptr;
+
+        for (int x = 0; x < size.width; ++x) {
+          if (row[x] == target) {
+            curr[x] = 0.0f;
+            continue;
+          }
+
+          float d = infinity;
+
+          if (prev != nullptr) {
+            d = std::min(d, prev[x] + 1.0f);
+          }
+
+          if (x > 0) {
+            d = std::min(d, curr[x - 1] + 1.0f);
+          }
+
+          curr[x] = d;
+        }
+      }
+
+      for (int y = size.height - 1; y >= 0; --y) {
+        float *curr = &distances({ 0, y });
+        const float *next = y < size.height - 1 ? &distances({ 0, y + 1 }) : nullptr;
+
+        for (int x = size.width - 1; x >= 0; --x) {
+          float d = curr[x];
+
+          if (next != nullptr) {
+            d = std::min(d, next[x] + 1.0f);
+          }
+
+          if (x < size.width - 1) {
+            d = std::min(d, curr[x + 1] + 1.0f);
+          }
+
+          curr[x] = d;
+        }
+      }
+    }
+
+    /*
+     * Squared Euclidean distance of a sampled function, in linear time, see:
+     * Felzenszwalb and Huttenlocher, Distance Transforms of Sampled Functions
+     */
+    void computeSquaredDistances1D(float *data, int count, int stride, ScratchVector<float>& values, ScratchVector<int>& vertices) {
+      values.resize(2 * count + 1);
+      vertices.resize(count);
+
+      float *f = values.data();
+      float *z = values.data() + count;
+      int *v = vertices.data();
+
+      for (int q = 0; q < count; ++q) {
+        f[q] = data[q * stride];
+      }
+
+      int k = 0;
+      v[0] = 0;
+      z[0] = -std::numeric_limits<float>::infinity();
+      z[1] = std::numeric_limits<float>::infinity();
+
+      for (int q = 1; q < count; ++q) {
+        float s = 0.0f;
+
+        for (;;) {
+          int p = v[k];
+          s = ((f[q] + q * q) - (f[p] + p * p)) / (2.0f * (q - p));
+
+          if (s > z[k]) {
+            break;
+          }
+
+          // z[0] is minus infinity, so k never goes below 0
+          --k;
+        }
+
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = std::numeric_limits<float>::infinity();
+      }
+
+      k = 0;
+
+      for (int q = 0; q < count; ++q) {
+        while (z[k + 1] < q) {
+          ++k;
+        }
+
+        int p = v[k];
+        data[q * stride] = static_cast<float>((q - p) * (q - p)) + f[p];
+      }
+    }
+
+    void computeEuclideanDistances(const Pixels& pixels, PaletteIndex target, Distances& distances) {
+      auto size = pixels.getSize();
+      const float infinity = static_cast<float>(4 * (size.width + size.height) * (size.width + size.height));
+
+      auto& scratch = Scratch::getLocal();
+      auto& values = scratch.getDistanceValues();
+      auto& vertices = scratch.getDistanceVertices();
+
+      for (auto pos : pixels.getPositionRange()) {
+        distances(pos) = pixels(pos) == target ? 0.0f : infinity;
+      }
+
+      for (int x = 0; x < size.width; ++x) {
+        computeSquaredDistances1D(&distances({ x, 0 }), size.height, size.width, values, vertices);
+      }
+
+      for (int y = 0; y < size.height; ++y) {
+        computeSquaredDistances1D(&distances({ 0, y }), size.width, 1, values, vertices);
+      }
+
+      for (auto& distance : distances) {
+        distance = std::sqrt(distance);
+      }
+    }
+
+  }
+
+  void computeDistances(const Pixels& pixels, PaletteIndex target, DistanceMetric metric, Distances& distances) {
+    assert(pixels.getSize() == distances.getSize());
+
+    switch (metric) {
+      case DistanceMetric::Manhattan:
+        computeManhattanDistances(pixels, target, distances);
+        break;
+      case DistanceMetric::Euclidean:
+        computeEuclideanDistances(pixels, target, distances);
+        break;
+    }
+
+    // farther than any pixel of the tile
+    const float maximum = static_cast<float>(pixels.getSize().width * 2);
+
+    for (auto& distance : distances) {
+      distance = std::min(distance, maximum);
+    }
+  }
+
+}
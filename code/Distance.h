@@ -0,0 +1,18 @@
+#ifndef TILEGEN_DISTANCE_H
+#define TILEGEN_DISTANCE_H
+
+#include <gf/Array2D.h>
+
+#include "Biomes.h"
+#include "Tile.h"
+
+namespace tlgn {
+
+  using Distances = gf::Array2D<float, int>;
+
+  // distance of every pixel to the nearest pixel of the target biome, or twice the size of the tile if there is none
+  void computeDistances(const Pixels& pixels, PaletteIndex target, DistanceMetric metric, Distances& distances);
+
+}
+
+#endif // TILEGEN_DISTANCE_H
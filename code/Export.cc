@@ -1,56 +1,137 @@
 #include "Export.h"
 
+#include <algorithm>
+#include <limits>
+#include <string>
+
 #include <gf/Color.h>
-#include <gf/Image.h>
 #include <gf/VectorOps.h>
 
+#include "Log.h"
+#include "Png.h"
+#include "Profile.h"
 #include "Settings.h"
 
 namespace tlgn {
 
   namespace {
 
-    template<typename T>
-    void blit(const gf::Array2D<T, int>& source, gf::Array2D<T, int>& destination, gf::Vector2i offset) {
+    // the tile is turned while it is written, block by block so that the
+    // column accesses of a quarter turn stay in cache
+    void blit(const Tile& tile, Texels& destination, gf::Vector2i offset) {
+      const Texels& source = tile.texels;
       auto sourceSize = source.getSize();
       auto destinationSize = destination.getSize();
 
+      assert(sourceSize.width == sourceSize.height);
       assert(offset.x >= 0);
       assert(offset.y >= 0);
       assert(offset.x + sourceSize.width <= destinationSize.width);
       assert(offset.y + sourceSize.height <= destinationSize.height);
 
-      for (auto j : source.getRowRange()) {
-        for (auto i : source.getColRange()) {
-          destination({ offset.x + i, offset.y + j }) = source({ i, j });
+      int extent = sourceSize.width;
+
+      if (tile.orientation == 0) {
+        for (auto j : source.getRowRange()) {
+          std::copy_n(&source({ 0, j }), extent, &destination({ offset.x, offset.y + j }));
+        }
+
+        return;
+      }
+
+      static constexpr int BlockSize = 16;
+
+      for (int by = 0; by < extent; by += BlockSize) {
+        int ymax = std::min(by + BlockSize, extent);
+
+        for (int bx = 0; bx < extent; bx += BlockSize) {
+          int xmax = std::min(bx + BlockSize, extent);
+
+          for (int j = by; j < ymax; ++j) {
+            gf::Color4u *row = &destination({ offset.x, offset.y + j });
+
+            for (int i = bx; i < xmax; ++i) {
+              row[i] = source(computeCanonicalPosition({ i, j }, extent, tile.orientation));
+            }
+          }
         }
       }
     }
 
+    uint64_t computeTexelsHash(const Texels& texels) {
+      // FNV-1a on whole texels
+      uint64_t hash = UINT64_C(0xcbf29ce484222325);
+
+      for (auto& texel : texels) {
+        uint32_t value = texel.r | (texel.g << 8) | (texel.b << 16) | (static_cast<uint32_t>(texel.a) << 24);
+        hash ^= value;
+        hash *= UINT64_C(0x100000001b3);
+      }
+
+      return hash;
+    }
+
+    bool hasSameFences(const Fences& lhs, const Fences& rhs) {
+      if (lhs.count != rhs.count) {
+        return false;
+      }
+
+      for (int i = 0; i < lhs.count; ++i) {
+        if (lhs.fence[i].d1 != rhs.fence[i].d1 || lhs.fence[i].d2 != rhs.fence[i].d2) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
   }
 
-  void exportTilesetsToImage(std::vector<Tileset>& tilesets, const Settings& settings, Colors& image, ImageContext& ctx) {
+  void exportTilesetsToImage(std::vector<Tileset>& tilesets, const Settings& settings, Texels& image, ImageContext& ctx) {
+    exportTilesetsToImage(tilesets, std::vector<bool>(tilesets.size(), true), settings, image, ctx);
+  }
+
+  void exportTilesetsToImage(std::vector<Tileset>& tilesets, const std::vector<bool>& selected, const Settings& settings, Texels& image, ImageContext& ctx) {
+    assert(selected.size() == tilesets.size());
+
+    if (tilesets.empty()) {
+      return;
+    }
+
+    ProfileScope scope(Phase::Blit);
+
+    const bool debug = isVerbose(Verbosity::Debug);
+
     auto imageSize = image.getSize();
     auto tilesetSize = tilesets.front().getSize();
 
-    std::cout << "===================================================\n";
-    std::cout << "Image size: " << std::dec << imageSize.width << ',' << imageSize.height << '\n';
-    std::cout << "Tileset size: " << tilesetSize.width << ',' << tilesetSize.height << '\n';
+    if (debug) {
+      std::cout << "===================================================\n";
+      std::cout << "Image size: " << std::dec << imageSize.width << ',' << imageSize.height << '\n';
+      std::cout << "Tileset size: " << tilesetSize.width << ',' << tilesetSize.height << '\n';
+    }
 
-    gf::Vector2i offset(0, ctx.startingPixelRow);
+    gf::Vector2i offset(0, ctx.startingPixelRow - ctx.bufferPixelRow);
 
     int tilesetsPerRow = imageSize.width / (settings.tile.getExtendedSize() * tilesetSize.width);
 
     int tilesPerRow = imageSize.width / settings.tile.getExtendedSize();
     int idOffset = (ctx.startingPixelRow / settings.tile.getExtendedSize()) * tilesPerRow;
 
-    std::cout << std::dec << "startingPixelRow: " << ctx.startingPixelRow << '\n';
-    std::cout << std::dec << "tilesPerRow: " << tilesPerRow << '\n';
-    std::cout << "idOffset: " << idOffset << '\n';
+    if (debug) {
+      std::cout << std::dec << "startingPixelRow: " << ctx.startingPixelRow << '\n';
+      std::cout << std::dec << "tilesPerRow: " << tilesPerRow << '\n';
+      std::cout << "idOffset: " << idOffset << '\n';
+    }
 
     int indexTileset = 0;
 
     for (auto& tileset : tilesets) {
+      if (!selected[indexTileset]) {
+        indexTileset++;
+        continue;
+      }
+
       assert(tileset.getSize() == tilesetSize);
 
       gf::Vector2i offsetTileset;
@@ -59,7 +140,9 @@ namespace tlgn {
 
       int idTileset = offsetTileset.y * tilesetSize.height * tilesPerRow + offsetTileset.x * tilesetSize.width;
 
-      std::cout << "idTileset: " << idTileset << '\n';
+      if (debug) {
+        std::cout << "idTileset: " << idTileset << '\n';
+      }
 
       int indexTile = 0;
 
@@ -70,14 +153,17 @@ namespace tlgn {
 
         gf::Vector2i totalOffset = offset + (offsetTileset * tilesetSize + offsetTile) * settings.tile.getExtendedSize();
 
-        std::cout << "offset: " << std::dec << offset.x << ',' << offset.y << '\n';
-        std::cout << "offsetTileset: " << std::dec << offsetTileset.x << ',' << offsetTileset.y << '\n';
-        std::cout << "offsetTile: " << std::dec << offsetTile.x << ',' << offsetTile.y << '\n';
-        std::cout << "totalOffset: " << std::dec << totalOffset.x << ',' << totalOffset.y << '\n';
+        if (debug) {
+          std::cout << "offset: " << std::dec << offset.x << ',' << offset.y << '\n';
+          std::cout << "offsetTileset: " << std::dec << offsetTileset.x << ',' << offsetTileset.y << '\n';
+          std::cout << "offsetTile: " << std::dec << offsetTile.x << ',' << offsetTile.y << '\n';
+          std::cout << "totalOffset: " << std::dec << totalOffset.x << ',' << totalOffset.y << '\n';
+        }
 
-        blit(tile.colors, image, totalOffset);
+        blit(tile, image, totalOffset);
 
         tile.id = idOffset + idTileset + offsetTile.y * tilesPerRow + offsetTile.x;
+        tile.page = 0;
 
         indexTile++;
       }
@@ -89,76 +175,239 @@ namespace tlgn {
     ctx.startingPixelRow += numberOfRows * tilesetSize.height * settings.tile.getExtendedSize();
   }
 
-  void exportImageToFile(const Colors& image, const gf::Path& filename) {
-    auto size = image.getSize();
+  void renderTile(const Tile& tile, Texels& texels) {
+    assert(texels.getSize() == tile.texels.getSize());
+    blit(tile, texels, { 0, 0 });
+  }
+
+  void exportTilesetsToAtlas(std::vector<Tileset>& tilesets, const std::vector<AtlasPlacement>& placements, const std::vector<bool>& selected, const Settings& settings, std::vector<Texels>& pages) {
+    assert(placements.size() == tilesets.size());
+    assert(selected.size() == tilesets.size());
+
+    ProfileScope scope(Phase::Blit);
+
+    const int extendedSize = settings.tile.getExtendedSize();
+    const int tilesPerRow = settings.page.width / extendedSize;
+
+    for (std::size_t i = 0; i < tilesets.size(); ++i) {
+      if (!selected[i]) {
+        continue;
+      }
+
+      const AtlasPlacement& placement = placements[i];
+      assert(0 <= placement.page && static_cast<std::size_t>(placement.page) < pages.size());
+
+      for (auto position : tilesets[i].getPositionRange()) {
+        Tile& tile = tilesets[i](position);
+        gf::Vector2i tilePosition = placement.position + position;
+
+        blit(tile, pages[placement.page], tilePosition * extendedSize);
+
+        tile.id = tilePosition.y * tilesPerRow + tilePosition.x;
+        tile.page = placement.page;
+      }
+    }
+  }
+
+  UniqueTiles::UniqueTiles(const Settings& settings)
+  : m_settings(settings)
+  , m_rendered(settings.tile.getExtendedTileSize())
+  , m_candidate(settings.tile.getExtendedTileSize())
+  {
+    const int extendedSize = settings.tile.getExtendedSize();
+
+    if (settings.hasPages()) {
+      gf::Vector2i tileCount = settings.page / extendedSize;
+      m_tilesPerRow = tileCount.width;
+      m_tilesPerImage = tileCount.width * tileCount.height;
+    } else {
+      m_tilesPerRow = settings.image.width / extendedSize;
+      m_tilesPerImage = std::numeric_limits<int>::max();
+    }
+
+    assert(m_tilesPerRow > 0 && m_tilesPerImage > 0);
+  }
+
+  void UniqueTiles::add(std::vector<Tileset>& tilesets) {
+    for (auto& tileset : tilesets) {
+      for (auto& tile : tileset) {
+        int index = getIndex(tile);
+        tile.id = index % m_tilesPerImage;
+        tile.page = index / m_tilesPerImage;
+      }
+    }
+  }
+
+  std::vector<Texels> UniqueTiles::exportToImages() const {
+    ProfileScope scope(Phase::Blit);
+
+    const int extendedSize = m_settings.tile.getExtendedSize();
+    std::vector<Texels> images;
+
+    if (m_settings.hasPages()) {
+      std::size_t count = (m_tiles.size() + m_tilesPerImage - 1) / m_tilesPerImage;
+      images.assign(count, Texels(m_settings.page));
+    } else {
+      int rows = static_cast<int>((m_tiles.size() + m_tilesPerRow - 1) / m_tilesPerRow);
+      images.emplace_back(gf::Vector2i(m_settings.image.width, std::max(rows, 1) * extendedSize));
+    }
+
+    for (std::size_t i = 0; i < m_tiles.size(); ++i) {
+      int id = static_cast<int>(i) % m_tilesPerImage;
+      gf::Vector2i position(id % m_tilesPerRow, id / m_tilesPerRow);
+      blit(*m_tiles[i], images[i / m_tilesPerImage], position * extendedSize);
+    }
+
+    return images;
+  }
+
+  int UniqueTiles::getIndex(const Tile& tile) {
+    blit(tile, m_rendered, { 0, 0 });
+
+    uint64_t hash = computeTexelsHash(m_rendered);
+    auto range = m_hashes.equal_range(hash);
+
+    for (auto it = range.first; it != range.second; ++it) {
+      const Tile& other = *m_tiles[it->second];
+
+      if (other.terrain != tile.terrain || !hasSameFences(other.fences, tile.fences)) {
+        continue;
+      }
+
+      blit(other, m_candidate, { 0, 0 });
+
+      if (std::equal(m_rendered.begin(), m_rendered.end(), m_candidate.begin())) {
+        return it->second;
+      }
+    }
+
+    int index = static_cast<int>(m_tiles.size());
+    m_hashes.insert({ hash, index });
+    m_tiles.push_back(&tile);
+    return index;
+  }
+
+  bool exportImageToFile(const Texels& image, const gf::Path& filename, int level, ThreadPool& pool) {
+    return writePng(image, filename, level, pool);
+  }
 
-    gf::Image out(size, gf::Color::toRgba32(gf::Color::Transparent));
+  namespace {
 
-    for (auto pos : image.getPositionRange()) {
-      gf::Color4f raw = image(pos);
-      gf::Color4u color = gf::Color::toRgba32(raw);
-      out.setPixel(pos, color);
+    bool hasSameTerrain(const Terrain& terrain, const Tile& tile, const Database& db) {
+      for (std::size_t i = 0; i < 4; ++i) {
+        if (terrain.indices[i] != db.getIndex(tile.terrain[i])) {
+          return false;
+        }
+      }
+
+      return hasSameFences(terrain.fences, tile.fences);
     }
 
-    out.saveToFile(filename);
   }
 
   void exportTilesetsToTerrains(const std::vector<Tileset>& tilesets, const Database& db, Terrains& terrains) {
+    exportTilesetsToTerrains(tilesets, db, 0, terrains);
+  }
+
+  void exportTilesetsToTerrains(const std::vector<Tileset>& tilesets, const Database& db, int page, Terrains& terrains) {
+    terrains.uniform.resize(db.getCompiled().getTerrainCount(), -1);
+
     for (auto& tileset : tilesets) {
       for (auto& tile : tileset) {
-        Terrain terrain;
+        if (tile.page != page) {
+          continue;
+        }
+
+        assert(tile.id >= 0);
+
+        if (static_cast<std::size_t>(tile.id) >= terrains.tiles.size()) {
+          terrains.tiles.resize(std::max(static_cast<std::size_t>(tile.id) + 1, 2 * terrains.tiles.size()));
+        }
+
+        Terrain& terrain = terrains.tiles[tile.id];
+
+        if (terrain.defined) {
+          // the deduplicated tiles share their id
+          if (!hasSameTerrain(terrain, tile, db)) {
+            std::cerr << "Duplicate index: " << tile.id << '\n';
+          }
+
+          continue;
+        }
 
         terrain.indices[0] = db.getIndex(tile.terrain[0]);
         terrain.indices[1] = db.getIndex(tile.terrain[1]);
         terrain.indices[2] = db.getIndex(tile.terrain[2]);
         terrain.indices[3] = db.getIndex(tile.terrain[3]);
+        terrain.fences = tile.fences;
+        terrain.defined = true;
 
-        if (terrains.find(tile.id) != terrains.end()) {
-          std::cerr << "Duplicate index: " << tile.id << '\n';
-        }
+        int index = terrain.indices[0];
 
-        terrain.fences = tile.fences;
+        if (index >= 0 && std::all_of(terrain.indices.begin(), terrain.indices.end(), [index](int other) { return other == index; })) {
+          int& uniform = terrains.uniform[index];
 
-        terrains.insert({ tile.id, terrain });
+          if (uniform == -1 || tile.id < uniform) {
+            uniform = tile.id;
+          }
+        }
       }
     }
   }
 
-
   namespace {
 
-    int findTerrainBiome(const Terrains& terrains, int index) {
-      std::array<int, 4> model = { index, index, index, index };
+    /*
+     * The XML is formatted in a single buffer, without any stream operation,
+     * and written at once.
+     */
+    class TextBuffer {
+    public:
+      explicit TextBuffer(std::size_t capacity) {
+        m_data.reserve(capacity);
+      }
 
-      for (auto& terrain : terrains) {
-        if (terrain.second.indices == model) {
-          return terrain.first;
-        }
+      TextBuffer& operator<<(const char *text) {
+        m_data.append(text);
+        return *this;
       }
 
-      return -1;
-    }
+      TextBuffer& operator<<(const std::string& text) {
+        m_data.append(text);
+        return *this;
+      }
 
-    std::string dumpTerrainIndex(int index) {
-      return index >= 0 ? std::to_string(index) : "";
-    }
+      TextBuffer& operator<<(char c) {
+        m_data.push_back(c);
+        return *this;
+      }
 
-    std::string dumpTerrainFence(gf::Direction direction) {
-      switch (direction) {
-        case gf::Direction::Up:
-          return "U";
-        case gf::Direction::Right:
-          return "R";
-        case gf::Direction::Down:
-          return "D";
-        case gf::Direction::Left:
-          return "L";
-        default:
-          assert(false);
+      TextBuffer& operator<<(int value) {
+        char digits[16];
+        char *end = digits + sizeof digits;
+        char *curr = end;
+        unsigned magnitude = value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value);
+
+        do {
+          *--curr = static_cast<char>('0' + magnitude % 10);
+          magnitude /= 10;
+        } while (magnitude != 0);
+
+        if (value < 0) {
+          *--curr = '-';
+        }
+
+        m_data.append(curr, end);
+        return *this;
       }
 
-      return "?";
-    }
+      const std::string& getData() const {
+        return m_data;
+      }
+
+    private:
+      std::string m_data;
+    };
 
     template<typename T>
     struct KV {
@@ -172,71 +421,121 @@ namespace tlgn {
     }
 
     template<typename T>
-    std::ostream& operator<<(std::ostream& os, const KV<T>& kv) {
-      return os << kv.key << '=' << '"' << kv.value << '"';
+    TextBuffer& operator<<(TextBuffer& buffer, const KV<T>& kv) {
+      return buffer << kv.key << '=' << '"' << kv.value << '"';
+    }
+
+    void dumpTerrainIndex(TextBuffer& buffer, int index) {
+      if (index >= 0) {
+        buffer << index;
+      }
+    }
+
+    char dumpTerrainFence(gf::Direction direction) {
+      switch (direction) {
+        case gf::Direction::Up:
+          return 'U';
+        case gf::Direction::Right:
+          return 'R';
+        case gf::Direction::Down:
+          return 'D';
+        case gf::Direction::Left:
+          return 'L';
+        default:
+          assert(false);
+      }
+
+      return '?';
     }
 
+    // a tile without fence takes a bit less than that
+    constexpr std::size_t EstimatedTileLength = 48;
+
   }
 
   void exportTerrainsToFile(const Terrains& terrains, const Database& db, std::ostream& os) {
-    gf::Vector2i tileCount = db.settings.image / db.settings.tile.getExtendedTileSize();
+    exportTerrainsToFile(terrains, db, db.settings.name, "biomes.png", db.settings.image, os);
+  }
 
-    os << "<?xml " << kv("version", "1.0") << ' ' << kv("encoding", "UTF-8") << "?>\n";
-    os << "<tileset " << kv("name", db.settings.name) << ' '
+  void exportTerrainsToFile(const Terrains& terrains, const Database& db, const std::string& name, const std::string& source, gf::Vector2i imageSize, std::ostream& os) {
+    gf::Vector2i tileCount = imageSize / db.settings.tile.getExtendedTileSize();
+
+    TextBuffer buffer(1024 + terrains.tiles.size() * EstimatedTileLength);
+
+    buffer << "<?xml " << kv("version", "1.0") << ' ' << kv("encoding", "UTF-8") << "?>\n";
+    buffer << "<tileset " << kv("name", name) << ' '
         << kv("tilewidth", db.settings.tile.size) << ' ' << kv("tileheight", db.settings.tile.size) << ' '
         << kv("tilecount", tileCount.width * tileCount.height) << ' ' << kv("columns", tileCount.width) << ' '
         << kv("spacing", db.settings.tile.spacing * 2) << ' ' << kv("margin", db.settings.tile.spacing)
         << ">\n";
-    os << "<image " << kv("source", "biomes.png") << ' ' // TODO: pass the source name in the parameter
-        << kv("width", db.settings.image.width) << ' ' << kv("height", db.settings.image.height)
+    buffer << "<image " << kv("source", source) << ' '
+        << kv("width", imageSize.width) << ' ' << kv("height", imageSize.height)
         << "/>\n";
 
-    os << "<terraintypes>\n";
+    buffer << "<terraintypes>\n";
 
-    std::map<int, std::reference_wrapper<const Biome>> biomes;
+    // the indices are checked when the database is loaded, not when it is built in code
+    std::vector<const Biome *> biomes(db.getCompiled().getTerrainCount(), nullptr);
 
     for (auto& pair : db.biomes) {
-      biomes.insert({ pair.second.index, pair.second });
+      assert(pair.second.index >= 0);
+
+      if (pair.second.index >= 0) {
+        biomes[pair.second.index] = &pair.second;
+      }
     }
 
-    int index = 0;
+    for (auto biome : biomes) {
+      assert(biome != nullptr);
 
-    for (auto& pair : biomes) {
-      assert(pair.first == index);
-      const Biome& biome = pair.second;
-      os << "\t<terrain " << kv("name", biome.name) << ' ' << kv("tile", findTerrainBiome(terrains, biome.index)) << "/>\n";
-      index++;
+      if (biome == nullptr) {
+        continue;
+      }
+
+      int tile = static_cast<std::size_t>(biome->index) < terrains.uniform.size() ? terrains.uniform[biome->index] : -1;
+      buffer << "\t<terrain " << kv("name", biome->name) << ' ' << kv("tile", tile) << "/>\n";
     }
 
-    os << "</terraintypes>\n";
+    buffer << "</terraintypes>\n";
+
+    for (std::size_t id = 0; id < terrains.tiles.size(); ++id) {
+      const Terrain& terrain = terrains.tiles[id];
 
-    for (auto& pair : terrains) {
-      const Terrain& terrain = pair.second;
+      if (!terrain.defined) {
+        continue;
+      }
 
-      os << "<tile id=\"" << pair.first << "\" terrain=\""
-        << dumpTerrainIndex(terrain.indices[0]) << ','
-        << dumpTerrainIndex(terrain.indices[1]) << ','
-        << dumpTerrainIndex(terrain.indices[2]) << ','
-        << dumpTerrainIndex(terrain.indices[3]) << "\"";
+      buffer << "<tile id=\"" << static_cast<int>(id) << "\" terrain=\"";
+      dumpTerrainIndex(buffer, terrain.indices[0]);
+      buffer << ',';
+      dumpTerrainIndex(buffer, terrain.indices[1]);
+      buffer << ',';
+      dumpTerrainIndex(buffer, terrain.indices[2]);
+      buffer << ',';
+      dumpTerrainIndex(buffer, terrain.indices[3]);
+      buffer << '"';
 
       if (terrain.fences.count > 0) {
-        os << ">\n";
-        os << "\t<properties>\n";
-        os << "\t\t<property " << kv("name", "fence_count") << ' ' << kv("type", "int") << ' ' << kv("value", terrain.fences.count) << " />\n";
+        buffer << ">\n";
+        buffer << "\t<properties>\n";
+        buffer << "\t\t<property " << kv("name", "fence_count") << ' ' << kv("type", "int") << ' ' << kv("value", terrain.fences.count) << " />\n";
 
         for (int i = 0; i < terrain.fences.count; ++i) {
-          os << "\t\t<property name=\"fence" << i << "\" value=\"" << dumpTerrainFence(terrain.fences.fence[i].d1) << dumpTerrainFence(terrain.fences.fence[i].d2)  << "\"/>\n";
+          buffer << "\t\t<property name=\"fence" << i << "\" value=\"" << dumpTerrainFence(terrain.fences.fence[i].d1) << dumpTerrainFence(terrain.fences.fence[i].d2)  << "\"/>\n";
         }
 
-        os << "\t</properties>\n";
+        buffer << "\t</properties>\n";
 
-        os << "</tile>\n";
+        buffer << "</tile>\n";
       } else {
-        os << "/>\n";
+        buffer << "/>\n";
       }
     }
 
-    os << "</tileset>\n";
+    buffer << "</tileset>\n";
+
+    const std::string& data = buffer.getData();
+    os.write(data.data(), data.size());
   }
 
 }
@@ -2,11 +2,15 @@
 #define TILEGEN_EXPORT_H
 
 #include <array>
-#include <map>
+#include <vector>
 #include <iosfwd>
+#include <string>
+#include <unordered_map>
 
+#include "Atlas.h"
 #include "Database.h"
 #include "Settings.h"
+#include "ThreadPool.h"
 #include "Tile.h"
 #include "Tileset.h"
 
@@ -14,20 +18,71 @@ namespace tlgn {
 
   struct ImageContext {
     int startingPixelRow = 0;
+    int bufferPixelRow = 0; // row of the full image where the image buffer starts
   };
 
-  void exportTilesetsToImage(std::vector<Tileset>& tilesets, const Settings& settings, Colors& image, ImageContext& ctx);
-  void exportImageToFile(const Colors& image, const gf::Path& filename);
+  void exportTilesetsToImage(std::vector<Tileset>& tilesets, const Settings& settings, Texels& image, ImageContext& ctx);
+  // same layout, but only the selected tilesets are written
+  void exportTilesetsToImage(std::vector<Tileset>& tilesets, const std::vector<bool>& selected, const Settings& settings, Texels& image, ImageContext& ctx);
+  // the texels of the tile turned in its orientation, the texels have the extended size of the tile
+  void renderTile(const Tile& tile, Texels& texels);
+
+  // the tilesets at their place in the atlas, only the selected ones are written
+  void exportTilesetsToAtlas(std::vector<Tileset>& tilesets, const std::vector<AtlasPlacement>& placements, const std::vector<bool>& selected, const Settings& settings, std::vector<Texels>& pages);
+
+  /*
+   * The distinct tiles: the tiles with the same texels once turned, the same
+   * terrain and the same fences share a single place. The distinct tiles are
+   * written one after the other, in the image or on the pages.
+   */
+  class UniqueTiles {
+  public:
+    explicit UniqueTiles(const Settings& settings);
+
+    // gives an id and a page to the tiles, the tilesets must not move until the export
+    void add(std::vector<Tileset>& tilesets);
+
+    std::size_t getCount() const {
+      return m_tiles.size();
+    }
+
+    // one image cropped to the used rows, or the pages
+    std::vector<Texels> exportToImages() const;
+
+  private:
+    int getIndex(const Tile& tile);
+
+  private:
+    Settings m_settings;
+    int m_tilesPerRow;
+    int m_tilesPerImage;
+    std::unordered_multimap<uint64_t, int> m_hashes;
+    std::vector<const Tile *> m_tiles;
+    Texels m_rendered;
+    Texels m_candidate;
+  };
+
+  // false if the image could not be encoded or written
+  bool exportImageToFile(const Texels& image, const gf::Path& filename, int level, ThreadPool& pool);
 
   struct Terrain {
     std::array<int, 4> indices;
     Fences fences;
+    bool defined = false;
   };
 
-  using Terrains = std::map<int, Terrain>;
+  struct Terrains {
+    std::vector<Terrain> tiles; // indexed by tile id
+    std::vector<int> uniform; // indexed by biome index, the first tile with only this biome, or -1
+  };
 
   void exportTilesetsToTerrains(const std::vector<Tileset>& tilesets, const Database& db, Terrains& terrains);
+  // only the tiles of the page
+  void exportTilesetsToTerrains(const std::vector<Tileset>& tilesets, const Database& db, int page, Terrains& terrains);
+
+  // the terrains of biomes.png, the image of the settings
   void exportTerrainsToFile(const Terrains& terrains, const Database& db, std::ostream& os);
+  void exportTerrainsToFile(const Terrains& terrains, const Database& db, const std::string& name, const std::string& source, gf::Vector2i imageSize, std::ostream& os);
 
 }
 
@@ -0,0 +1,74 @@
+#include "Fill.h"
+
+#include "Scratch.h"
+
+namespace tlgn {
+
+  /*
+   * Scanline fill: a whole run of invalid pixels is filled at once, and only
+   * one seed per run is pushed for the rows above and below. The seed stack
+   * comes from the scratch buffers of the thread, so it does not allocate
+   * once warmed up.
+   */
+  void fillBiomeFrom(Pixels& pixels, gf::Vector2i pos, PaletteIndex biome) {
+    auto& seeds = Scratch::getLocal().getFillSeeds();
+
+    auto size = pixels.getSize();
+
+    auto scan = [&](int xmin, int xmax, int y) {
+      if (y < 0 || y >= size.height) {
+        return;
+      }
+
+      const PaletteIndex *row = &pixels({ 0, y });
+      int x = xmin;
+
+      while (x <= xmax) {
+        if (row[x] != InvalidIndex) {
+          ++x;
+          continue;
+        }
+
+        seeds.push_back({ x, y });
+
+        while (x <= xmax && row[x] == InvalidIndex) {
+          ++x;
+        }
+      }
+    };
+
+    auto fill = [&](int x, int y) {
+      PaletteIndex *row = &pixels({ 0, y });
+      int xmin = x;
+
+      while (xmin > 0 && row[xmin - 1] == InvalidIndex) {
+        --xmin;
+      }
+
+      int xmax = x;
+
+      while (xmax < size.width - 1 && row[xmax + 1] == InvalidIndex) {
+        ++xmax;
+      }
+
+      for (int i = xmin; i <= xmax; ++i) {
+        row[i] = biome;
+      }
+
+      scan(xmin, xmax, y - 1);
+      scan(xmin, xmax, y + 1);
+    };
+
+    fill(pos.x, pos.y);
+
+    while (!seeds.empty()) {
+      auto curr = seeds.back();
+      seeds.pop_back();
+
+      if (pixels(curr) == InvalidIndex) {
+        fill(curr.x, curr.y);
+      }
+    }
+  }
+
+}
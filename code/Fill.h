@@ -0,0 +1,15 @@
+#ifndef TILEGEN_FILL_H
+#define TILEGEN_FILL_H
+
+#include <gf/Vector.h>
+
+#include "Tile.h"
+
+namespace tlgn {
+
+  // fill the 4-connected region of invalid pixels reachable from pos (pos is always filled)
+  void fillBiomeFrom(Pixels& pixels, gf::Vector2i pos, PaletteIndex biome);
+
+}
+
+#endif // TILEGEN_FILL_H
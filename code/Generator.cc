@@ -0,0 +1,96 @@
+#include "Generator.h"
+
+#include <utility>
+
+#include "Cache.h"
+#include "Pipeline.h"
+#include "Png.h"
+
+namespace tlgn {
+
+  struct Generator::Impl {
+    ThreadPool pool;
+    TileCache cache;
+    Pipeline pipeline;
+
+    Impl(const GeneratorOptions& options)
+    : pool(options.jobs)
+    , cache(options.cacheDirectory)
+    , pipeline(options.seed, cache, pool)
+    {
+      pipeline.setPngLevel(options.pngLevel < 0 ? DefaultPngLevel : options.pngLevel);
+      pipeline.setDedupe(options.dedupe);
+    }
+  };
+
+  Generator::Generator(const GeneratorOptions& options)
+  : m_impl(new Impl(options))
+  {
+  }
+
+  Generator::~Generator() = default;
+
+  std::size_t Generator::generate(Database db) {
+    if (!m_impl->pipeline.run(std::move(db))) {
+      return 0;
+    }
+
+    return m_impl->pipeline.getImageCount();
+  }
+
+  std::size_t Generator::generate(const std::string& json) {
+    return generate(Database::parse(json));
+  }
+
+  std::size_t Generator::update(Database db) {
+    m_impl->pipeline.update(std::move(db));
+
+    if (!m_impl->pipeline.isReady()) {
+      return 0;
+    }
+
+    return m_impl->pipeline.getImageCount();
+  }
+
+  std::size_t Generator::getImageCount() const {
+    return m_impl->pipeline.getImageCount();
+  }
+
+  const Texels& Generator::getImage(std::size_t index) const {
+    return m_impl->pipeline.getImage(index);
+  }
+
+  Terrains Generator::getTerrains(std::size_t index) const {
+    return m_impl->pipeline.computeTerrains(index);
+  }
+
+  void Generator::writeTileset(std::size_t index, const std::string& source, std::ostream& os) const {
+    m_impl->pipeline.writeTileset(index, source, os);
+  }
+
+  bool Generator::writeFiles() const {
+    return m_impl->pipeline.writeFiles();
+  }
+
+  bool Generator::stream(Database db) {
+    if (!m_impl->pipeline.stream(std::move(db), "biomes.png")) {
+      return false;
+    }
+
+    return m_impl->pipeline.writeTerrains();
+  }
+
+  bool Generator::hasCache() const {
+    return m_impl->cache.isEnabled();
+  }
+
+  GeneratorCacheStats Generator::getCacheStats() const {
+    auto stats = m_impl->cache.getStats();
+    return { stats.hits, stats.misses };
+  }
+
+  Pipeline& getPipeline(Generator& generator) {
+    return generator.m_impl->pipeline;
+  }
+
+}
@@ -0,0 +1,84 @@
+#ifndef TILEGEN_GENERATOR_H
+#define TILEGEN_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+
+#include <gf/Path.h>
+
+#include "Database.h"
+#include "Export.h"
+#include "Log.h"
+#include "Seed.h"
+#include "ThreadPool.h"
+#include "Tile.h"
+
+namespace tlgn {
+
+  class Pipeline;
+
+  struct GeneratorOptions {
+    uint64_t seed = computeDefaultSeed();
+    unsigned jobs = ThreadPool::getDefaultJobs();
+    gf::Path cacheDirectory; // no cache if empty
+    int pngLevel = -1; // from 0 to 9, -1 for the default level of the encoder
+    bool dedupe = false;
+  };
+
+  struct GeneratorCacheStats {
+    std::size_t hits;
+    std::size_t misses;
+  };
+
+  /*
+   * The interface of the library. A database goes in, the images of the
+   * atlas and the terrains of their tiles come out, in memory. There is a
+   * single image, or one image per page if the settings have a page size.
+   * The messages on the standard output can be removed with
+   * setVerbosity(Verbosity::Quiet).
+   */
+  class Generator {
+  public:
+    explicit Generator(const GeneratorOptions& options);
+    ~Generator();
+
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+
+    // computes the whole atlas, returns the number of images, 0 on error (the tilesets do not fit in the pages)
+    std::size_t generate(Database db);
+    std::size_t generate(const std::string& json);
+
+    // computes again only the tilesets whose inputs changed, returns the number of images, 0 on error
+    std::size_t update(Database db);
+
+    std::size_t getImageCount() const;
+    const Texels& getImage(std::size_t index) const;
+    Terrains getTerrains(std::size_t index) const;
+
+    // the TSX of an image, with the name of the file of the image
+    void writeTileset(std::size_t index, const std::string& source, std::ostream& os) const;
+
+    // biomes.png and biomes.tsx, or a pair of files per page, in the current directory, false if a file could not be written
+    bool writeFiles() const;
+
+    // computes the atlas and writes it in biomes.png without keeping it, then writes biomes.tsx, false if a file could not be written
+    bool stream(Database db);
+
+    bool hasCache() const;
+    GeneratorCacheStats getCacheStats() const;
+
+  private:
+    // the watch mode of tilegen works on the pipeline
+    friend Pipeline& getPipeline(Generator& generator);
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+  };
+
+}
+
+#endif // TILEGEN_GENERATOR_H
@@ -0,0 +1,53 @@
+#include "Line.h"
+
+#include <gf/Geometry.h>
+#include <gf/VectorOps.h>
+
+#include "Scratch.h"
+
+namespace tlgn {
+
+  void drawLine(Pixels& pixels, const TileSettings& settings, gf::ArrayRef<gf::Vector2i> points, gf::Random& random, PaletteIndex biome) {
+    constexpr unsigned GenerationIterations = 2;
+    constexpr float InitialFactor = 0.5f;
+    constexpr float ReductionFactor = 0.6f;
+
+    // generate random line points
+
+    auto& tmp = Scratch::getLocal().getLinePoints();
+
+    // the vectors returned by gf are not scratch buffers, they are counted as such
+
+    for (std::size_t i = 0; i < points.getSize() - 1; ++i) {
+      auto line = gf::midpointDisplacement1D(points[i], points[i + 1], random, GenerationIterations, InitialFactor, ReductionFactor);
+      countScratchAllocation();
+      tmp.insert(tmp.end(), line.begin(), line.end());
+      tmp.pop_back();
+    }
+
+    tmp.push_back(points[points.getSize() - 1]);
+
+    // normalize
+
+    for (auto& point : tmp) {
+      point = gf::clamp(point, 0, settings.size - 1);
+    }
+
+    // draw final line
+
+    for (std::size_t i = 0; i < tmp.size() - 1; ++i) {
+      auto line = gf::generateLine(tmp[i], tmp[i + 1]);
+
+      if (line.capacity() > 0) {
+        countScratchAllocation();
+      }
+
+      for (auto point : line) {
+        pixels(point) = biome;
+      }
+    }
+
+    pixels(points[points.getSize() - 1]) = biome;
+  }
+
+}
@@ -0,0 +1,18 @@
+#ifndef TILEGEN_LINE_H
+#define TILEGEN_LINE_H
+
+#include <gf/ArrayRef.h>
+#include <gf/Random.h>
+#include <gf/Vector.h>
+
+#include "Settings.h"
+#include "Tile.h"
+
+namespace tlgn {
+
+  // draw a random frontier through the points, each segment is displaced from the straight line
+  void drawLine(Pixels& pixels, const TileSettings& settings, gf::ArrayRef<gf::Vector2i> points, gf::Random& random, PaletteIndex biome);
+
+}
+
+#endif // TILEGEN_LINE_H
@@ -0,0 +1,21 @@
+#include "Log.h"
+
+#include <atomic>
+
+namespace tlgn {
+
+  namespace {
+
+    std::atomic<Verbosity> g_verbosity(Verbosity::Normal);
+
+  }
+
+  void setVerbosity(Verbosity verbosity) {
+    g_verbosity.store(verbosity);
+  }
+
+  bool isVerbose(Verbosity verbosity) {
+    return static_cast<int>(g_verbosity.load(std::memory_order_relaxed)) >= static_cast<int>(verbosity);
+  }
+
+}
@@ -0,0 +1,17 @@
+#ifndef TILEGEN_LOG_H
+#define TILEGEN_LOG_H
+
+namespace tlgn {
+
+  enum class Verbosity {
+    Quiet, // only the errors
+    Normal,
+    Debug, // the details of the layout of every tile
+  };
+
+  void setVerbosity(Verbosity verbosity);
+  bool isVerbose(Verbosity verbosity);
+
+}
+
+#endif // TILEGEN_LOG_H
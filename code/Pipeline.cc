@@ -0,0 +1,464 @@
+#include "Pipeline.h"
+
+#include <cassert>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <gf/VectorOps.h>
+
+#include "Export.h"
+#include "Log.h"
+#include "Png.h"
+#include "Profile.h"
+
+namespace tlgn {
+
+  namespace {
+
+    constexpr SeedCategory Categories[] = {
+      SeedCategory::Plain,
+      SeedCategory::TwoCorners,
+      SeedCategory::ThreeCorners,
+      SeedCategory::Overlay,
+    };
+
+    constexpr int BlankRows = 64;
+
+    bool hasSameLayout(const Settings& lhs, const Settings& rhs) {
+      return lhs.tile.size == rhs.tile.size && lhs.tile.spacing == rhs.tile.spacing && lhs.image.width == rhs.image.width && lhs.image.height == rhs.image.height && lhs.page.width == rhs.page.width && lhs.page.height == rhs.page.height;
+    }
+
+  }
+
+  Pipeline::Pipeline(uint64_t seed, TileCache& cache, ThreadPool& pool)
+  : m_seed(seed)
+  , m_cache(cache)
+  , m_pool(pool)
+  , m_pngLevel(DefaultPngLevel)
+  , m_dedupe(false)
+  , m_ready(false)
+  {
+  }
+
+  bool Pipeline::run(Database db) {
+    m_db = std::move(db);
+    m_db.compile(); // the database may have been built in code
+    planCategories();
+
+    for (std::size_t i = 0; i < m_categories.size(); ++i) {
+      if (isVerbose(Verbosity::Normal)) {
+        std::cout << "Computing tilesets (" << (i + 1) << "/4)...\n";
+      }
+
+      auto& category = m_categories[i];
+      computeTilesets(category, std::vector<bool>(category.plans.size(), true));
+    }
+
+    if (isVerbose(Verbosity::Normal)) {
+      std::cout << "Computing biome image...\n";
+    }
+
+    m_ready = composeImage();
+    m_changedImages.assign(getImageCount(), true);
+    return m_ready;
+  }
+
+  std::size_t Pipeline::update(Database db) {
+    if (!m_ready || !hasSameLayout(m_db.settings, db.settings)) {
+      run(std::move(db));
+
+      std::size_t count = 0;
+
+      for (auto& category : m_categories) {
+        count += category.tilesets.size();
+      }
+
+      return count;
+    }
+
+    m_db = std::move(db);
+    m_db.compile();
+
+    std::size_t count = 0;
+    bool sameLayout = true;
+    std::array<std::vector<bool>, 4> changes;
+
+    for (std::size_t i = 0; i < m_categories.size(); ++i) {
+      auto& category = m_categories[i];
+      auto plans = planTilesets(Categories[i], m_seed, m_db);
+
+      std::vector<CacheKey> keys;
+      std::vector<Tileset> tilesets(plans.size());
+      std::vector<bool> changed(plans.size(), true);
+
+      for (std::size_t j = 0; j < plans.size(); ++j) {
+        keys.push_back(computeCacheKey(plans[j], m_db));
+
+        if (j < category.keys.size() && category.keys[j].data == keys[j].data) {
+          tilesets[j] = std::move(category.tilesets[j]);
+          changed[j] = false;
+        } else {
+          ++count;
+        }
+      }
+
+      if (plans.size() != category.plans.size()) {
+        sameLayout = false;
+      }
+
+      category.plans = std::move(plans);
+      category.keys = std::move(keys);
+      category.tilesets = std::move(tilesets);
+      computeTilesets(category, changed);
+      changes[i] = std::move(changed);
+    }
+
+    if (sameLayout && !m_dedupe) {
+      // the tilesets stay at the same place, only the changed ones are written again
+      ImageContext ctx;
+      m_changedImages.assign(getImageCount(), false);
+
+      for (std::size_t i = 0; i < m_categories.size(); ++i) {
+        auto& category = m_categories[i];
+
+        if (m_db.settings.hasPages()) {
+          assert(category.placements.size() == category.tilesets.size());
+          exportTilesetsToAtlas(category.tilesets, category.placements, changes[i], m_db.settings, m_pages);
+        } else {
+          exportTilesetsToImage(category.tilesets, changes[i], m_db.settings, m_image, ctx);
+        }
+
+        for (std::size_t j = 0; j < changes[i].size(); ++j) {
+          if (changes[i][j]) {
+            m_changedImages[m_db.settings.hasPages() ? category.placements[j].page : 0] = true;
+          }
+        }
+      }
+    } else {
+      m_ready = composeImage();
+      m_changedImages.assign(getImageCount(), true);
+    }
+
+    return count;
+  }
+
+  /*
+   * The tilesets are computed one row of the image at a time. Each row is
+   * written in a band buffer that is encoded right away, then the colors of
+   * its tiles are released. Only the data needed for the terrains is kept.
+   */
+  bool Pipeline::stream(Database db, const gf::Path& filename) {
+    m_db = std::move(db);
+    m_db.compile();
+    m_image = Texels();
+    m_pages.clear();
+    m_ready = false;
+    planCategories();
+
+    const auto& settings = m_db.settings;
+    const int extendedSize = settings.tile.getExtendedSize();
+
+    PngWriter writer(filename, settings.image, m_pngLevel, m_pool);
+    Texels band;
+    ImageContext ctx;
+
+    for (std::size_t i = 0; i < m_categories.size(); ++i) {
+      if (isVerbose(Verbosity::Normal)) {
+        std::cout << "Computing and writing tilesets (" << (i + 1) << "/4)...\n";
+      }
+
+      auto& category = m_categories[i];
+      std::size_t count = category.plans.size();
+
+      if (count == 0) {
+        continue;
+      }
+
+      gf::Vector2i tilesetSize = getTilesetSize(Categories[i]);
+      gf::Vector2i bandSize(settings.image.width, tilesetSize.height * extendedSize);
+      std::size_t tilesetsPerRow = settings.image.width / (tilesetSize.width * extendedSize);
+      assert(tilesetsPerRow > 0);
+
+      if (band.getSize() != bandSize) {
+        band = Texels(bandSize);
+      }
+
+      for (std::size_t first = 0; first < count; first += tilesetsPerRow) {
+        std::size_t last = std::min(first + tilesetsPerRow, count);
+
+        std::vector<bool> selected(count, false);
+        std::fill(selected.begin() + first, selected.begin() + last, true);
+        computeTilesets(category, selected);
+
+        std::fill(band.begin(), band.end(), gf::Color4u(0, 0, 0, 0));
+
+        ImageContext bandCtx = ctx;
+        bandCtx.bufferPixelRow = ctx.startingPixelRow + static_cast<int>(first / tilesetsPerRow) * bandSize.height;
+        exportTilesetsToImage(category.tilesets, selected, settings, band, bandCtx);
+
+        writer.appendRows(band.getDataPtr(), bandSize.height);
+
+        for (std::size_t j = first; j < last; ++j) {
+          for (auto& tile : category.tilesets[j]) {
+            tile.pixels = Pixels();
+            tile.texels = Texels();
+          }
+        }
+      }
+
+      int rows = static_cast<int>((count - 1) / tilesetsPerRow + 1);
+      ctx.startingPixelRow += rows * bandSize.height;
+    }
+
+    // the rest of the image is empty, there may be no tileset at all
+
+    assert(ctx.startingPixelRow <= settings.image.height);
+    Texels blank({ settings.image.width, BlankRows }, gf::Color4u(0, 0, 0, 0));
+
+    for (int row = ctx.startingPixelRow; row < settings.image.height; row += BlankRows) {
+      writer.appendRows(blank.getDataPtr(), std::min(BlankRows, settings.image.height - row));
+    }
+
+    return writer.finish();
+  }
+
+  void Pipeline::setPngLevel(int level) {
+    m_pngLevel = level;
+  }
+
+  void Pipeline::setDedupe(bool dedupe) {
+    m_dedupe = dedupe;
+  }
+
+  std::size_t Pipeline::getImageCount() const {
+    return m_db.settings.hasPages() ? m_pages.size() : 1;
+  }
+
+  const Texels& Pipeline::getImage(std::size_t index) const {
+    if (m_db.settings.hasPages()) {
+      assert(index < m_pages.size());
+      return m_pages[index];
+    }
+
+    assert(index == 0);
+    return m_image;
+  }
+
+  Terrains Pipeline::computeTerrains(std::size_t index) const {
+    Terrains terrains;
+
+    for (auto& category : m_categories) {
+      exportTilesetsToTerrains(category.tilesets, m_db, static_cast<int>(index), terrains);
+    }
+
+    return terrains;
+  }
+
+  void Pipeline::writeTileset(std::size_t index, const std::string& source, std::ostream& os) const {
+    Terrains terrains = computeTerrains(index);
+
+    if (m_db.settings.hasPages()) {
+      exportTerrainsToFile(terrains, m_db, m_db.settings.name + '-' + std::to_string(index), source, m_db.settings.page, os);
+      return;
+    }
+
+    // the streamed image is not kept, it has the size of the settings
+    gf::Vector2i imageSize = m_image.isEmpty() ? m_db.settings.image : m_image.getSize();
+    exportTerrainsToFile(terrains, m_db, m_db.settings.name, source, imageSize, os);
+  }
+
+  bool Pipeline::writeFiles() const {
+    if (isVerbose(Verbosity::Normal)) {
+      std::cout << (m_db.settings.hasPages() ? "Generating biome pages...\n" : "Generating biome image...\n");
+    }
+
+    for (std::size_t i = 0; i < getImageCount(); ++i) {
+      if (!exportImageToFile(getImage(i), getImageName(i, ".png"), m_pngLevel, m_pool)) {
+        return false;
+      }
+    }
+
+    return writeTerrains(false);
+  }
+
+  bool Pipeline::writeTerrains() const {
+    return writeTerrains(false);
+  }
+
+  bool Pipeline::writeChangedFiles() const {
+    for (std::size_t i = 0; i < getImageCount(); ++i) {
+      assert(i < m_changedImages.size());
+
+      if (m_changedImages[i] && !exportImageToFile(getImage(i), getImageName(i, ".png"), m_pngLevel, m_pool)) {
+        return false;
+      }
+    }
+
+    return writeTerrains(true);
+  }
+
+  std::string Pipeline::getImageName(std::size_t index, const char *extension) const {
+    if (m_db.settings.hasPages()) {
+      return "biomes-" + std::to_string(index) + extension;
+    }
+
+    return std::string("biomes") + extension;
+  }
+
+  bool Pipeline::writeTerrains(bool onlyChanged) const {
+    ProfileScope scope(Phase::Tsx);
+
+    if (isVerbose(Verbosity::Normal)) {
+      std::cout << (m_db.settings.hasPages() ? "Generating biome tilesets...\n" : "Generating biome tileset...\n");
+    }
+
+    m_writtenTerrains.resize(getImageCount());
+
+    for (std::size_t i = 0; i < getImageCount(); ++i) {
+      std::ostringstream os;
+      writeTileset(i, getImageName(i, ".png"), os);
+      std::string content = os.str();
+
+      if (onlyChanged && content == m_writtenTerrains[i]) {
+        continue;
+      }
+
+      std::string filename = getImageName(i, ".tsx");
+      std::ofstream tileset(filename);
+      tileset << content;
+      tileset.close();
+
+      if (!tileset) {
+        std::cerr << "Could not write the tileset file: " << filename << '\n';
+        m_writtenTerrains[i].clear();
+        return false;
+      }
+
+      m_writtenTerrains[i] = std::move(content);
+    }
+
+    return true;
+  }
+
+  void Pipeline::planCategories() {
+    for (std::size_t i = 0; i < m_categories.size(); ++i) {
+      auto& category = m_categories[i];
+      category.plans = planTilesets(Categories[i], m_seed, m_db);
+      category.keys.clear();
+
+      for (auto& plan : category.plans) {
+        category.keys.push_back(computeCacheKey(plan, m_db));
+      }
+
+      category.tilesets.clear();
+      category.tilesets.resize(category.plans.size());
+    }
+  }
+
+  bool Pipeline::composeImage() {
+    const auto& settings = m_db.settings;
+
+    if (m_dedupe) {
+      UniqueTiles unique(settings);
+      std::size_t count = 0;
+
+      for (auto& category : m_categories) {
+        unique.add(category.tilesets);
+        category.placements.clear();
+
+        for (auto& tileset : category.tilesets) {
+          count += tileset.getDataSize();
+        }
+      }
+
+      auto images = unique.exportToImages();
+
+      if (settings.hasPages()) {
+        m_image = Texels();
+        m_pages = std::move(images);
+      } else {
+        m_image = std::move(images.front());
+        m_pages.clear();
+      }
+
+      if (isVerbose(Verbosity::Normal)) {
+        std::cout << "Deduplicated " << count << " tiles to " << unique.getCount() << '\n';
+      }
+
+      return true;
+    }
+
+    if (!settings.hasPages()) {
+      m_image = Texels(settings.image);
+      m_pages.clear();
+
+      ImageContext ctx;
+
+      for (auto& category : m_categories) {
+        exportTilesetsToImage(category.tilesets, settings, m_image, ctx);
+      }
+
+      return true;
+    }
+
+    // all the categories are packed together
+
+    std::vector<gf::Vector2i> sizes;
+
+    for (std::size_t i = 0; i < m_categories.size(); ++i) {
+      sizes.insert(sizes.end(), m_categories[i].tilesets.size(), getTilesetSize(Categories[i]));
+    }
+
+    Atlas atlas;
+
+    if (!packAtlas(sizes, settings.page / settings.tile.getExtendedSize(), atlas)) {
+      std::cerr << "Could not pack the tilesets in pages of " << settings.page.width << 'x' << settings.page.height << '\n';
+      m_image = Texels();
+      m_pages.clear();
+
+      for (auto& category : m_categories) {
+        category.placements.clear();
+      }
+
+      return false;
+    }
+
+    // an atlas without any tileset still has an empty page, like the image without pages
+    m_image = Texels();
+    m_pages.assign(std::max(atlas.pages, 1), Texels(settings.page));
+
+    auto placement = atlas.placements.begin();
+
+    for (auto& category : m_categories) {
+      category.placements.assign(placement, placement + category.tilesets.size());
+      placement += category.tilesets.size();
+
+      exportTilesetsToAtlas(category.tilesets, category.placements, std::vector<bool>(category.tilesets.size(), true), settings, m_pages);
+    }
+
+    if (isVerbose(Verbosity::Normal)) {
+      std::cout << "Packed " << sizes.size() << " tilesets in " << atlas.pages << " pages\n";
+    }
+
+    return true;
+  }
+
+  void Pipeline::computeTilesets(Category& category, const std::vector<bool>& selected) {
+    m_pool.parallelFor(category.plans.size(), [&](std::size_t i) {
+      if (!selected[i]) {
+        return;
+      }
+
+      auto& tileset = category.tilesets[i];
+
+      if (!m_cache.load(category.keys[i], tileset)) {
+        tileset = computeTileset(category.plans[i], m_db);
+        m_cache.save(category.keys[i], tileset);
+      }
+    });
+  }
+
+}
@@ -0,0 +1,104 @@
+#ifndef TILEGEN_PIPELINE_H
+#define TILEGEN_PIPELINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <gf/Path.h>
+
+#include "Atlas.h"
+#include "Cache.h"
+#include "Database.h"
+#include "Export.h"
+#include "Plan.h"
+#include "ThreadPool.h"
+#include "Tile.h"
+#include "Tileset.h"
+
+namespace tlgn {
+
+  /*
+   * The whole generation: the tilesets of the four categories and the
+   * image they are written in, or the pages of the atlas when the settings
+   * have a page size. The state is kept so that a new version of the
+   * database can be applied incrementally.
+   */
+  class Pipeline {
+  public:
+    Pipeline(uint64_t seed, TileCache& cache, ThreadPool& pool);
+
+    // computes everything from scratch, false if the image could not be composed (the tilesets do not fit in the pages)
+    bool run(Database db);
+
+    // recomputes only the tilesets whose inputs changed, returns their number; check isReady() afterwards
+    std::size_t update(Database db);
+
+    // true if the last run or update composed the image
+    bool isReady() const {
+      return m_ready;
+    }
+
+    // computes everything and writes the image band by band, without keeping it in memory, false if the image could not be written
+    bool stream(Database db, const gf::Path& filename);
+
+    // zlib level of the PNG image, from 0 to 9
+    void setPngLevel(int level);
+
+    // writes the identical tiles only once
+    void setDedupe(bool dedupe);
+
+    // the results after run or update: the image, or the pages of an atlas
+    std::size_t getImageCount() const;
+    const Texels& getImage(std::size_t index) const;
+    Terrains computeTerrains(std::size_t index) const;
+    void writeTileset(std::size_t index, const std::string& source, std::ostream& os) const;
+
+    // writes the image and the terrains, biomes-<page>.png and biomes-<page>.tsx for an atlas, false if a file could not be written
+    bool writeFiles() const;
+    bool writeTerrains() const;
+
+    // writes only the images changed by the last run or update, and the terrains that differ from the written ones
+    bool writeChangedFiles() const;
+
+  private:
+    struct Category {
+      std::vector<TilesetPlan> plans;
+      std::vector<CacheKey> keys;
+      std::vector<Tileset> tilesets;
+      std::vector<AtlasPlacement> placements; // only for an atlas
+    };
+
+    void planCategories();
+    std::string getImageName(std::size_t index, const char *extension) const;
+    bool writeTerrains(bool onlyChanged) const;
+    bool composeImage();
+    void computeTilesets(Category& category, const std::vector<bool>& selected);
+
+  private:
+    uint64_t m_seed;
+    TileCache& m_cache;
+    ThreadPool& m_pool;
+    int m_pngLevel;
+    bool m_dedupe;
+
+    bool m_ready;
+    Database m_db;
+    std::array<Category, 4> m_categories;
+    Texels m_image;
+    std::vector<Texels> m_pages;
+    std::vector<bool> m_changedImages;
+    mutable std::vector<std::string> m_writtenTerrains; // the content of the TSX files on disk
+  };
+
+  class Generator;
+
+  // the pipeline behind a generator, for the watch mode of tilegen
+  Pipeline& getPipeline(Generator& generator);
+
+}
+
+#endif // TILEGEN_PIPELINE_H
@@ -0,0 +1,90 @@
+#include "Plan.h"
+
+#include <map>
+
+#include "Profile.h"
+
+namespace tlgn {
+
+  std::vector<TilesetPlan> planTilesets(SeedCategory category, uint64_t seed, const Database& db) {
+    std::vector<TilesetPlan> plans;
+
+    auto add = [&](gf::Id b1, gf::Id b2, gf::Id b3) {
+      TilesetPlan plan;
+      plan.seed = { seed, category, plans.size() };
+      plan.biomes = { b1, b2, b3 };
+      plans.push_back(plan);
+    };
+
+    switch (category) {
+      case SeedCategory::Plain: {
+        std::map<int, gf::Id> biomes;
+
+        for (auto& pair : db.biomes) {
+          biomes.insert({ pair.second.index, pair.first });
+        }
+
+        for (auto& kv : biomes) {
+          add(kv.second, gf::InvalidId, gf::InvalidId);
+        }
+
+        break;
+      }
+
+      case SeedCategory::TwoCorners:
+        for (auto& duo : db.duos) {
+          add(duo.b1, duo.b2, gf::InvalidId);
+        }
+
+        break;
+
+      case SeedCategory::ThreeCorners:
+        for (auto& trio : db.trios) {
+          add(trio.b1, trio.b2, trio.b3);
+        }
+
+        break;
+
+      case SeedCategory::Overlay:
+        for (auto& overlay : db.overlays) {
+          add(overlay.b0, Void, gf::InvalidId);
+        }
+
+        break;
+    }
+
+    return plans;
+  }
+
+  Tileset computeTileset(const TilesetPlan& plan, const Database& db) {
+    Tileset tileset;
+
+    {
+      ProfileScope scope(Phase::Geometry);
+
+      switch (plan.seed.category) {
+        case SeedCategory::Plain:
+          tileset = generatePlainTileset(plan.biomes[0], db);
+          break;
+
+        case SeedCategory::TwoCorners:
+        case SeedCategory::Overlay:
+          tileset = generateTwoCornersWangTileset(plan.biomes[0], plan.biomes[1], plan.seed, db);
+          break;
+
+        case SeedCategory::ThreeCorners:
+          tileset = generateThreeCornersWangTileset(plan.biomes[0], plan.biomes[1], plan.biomes[2], plan.seed, db);
+          break;
+      }
+    }
+
+    for (auto position : tileset.getPositionRange()) {
+      ProfileScope scope(Phase::Colorize, "tile");
+      gf::Random random = plan.seed.getTileRandom(position, SeedPurpose::Colors);
+      tileset(position).colorize(db, random);
+    }
+
+    return tileset;
+  }
+
+}
@@ -0,0 +1,28 @@
+#ifndef TILEGEN_PLAN_H
+#define TILEGEN_PLAN_H
+
+#include <array>
+#include <vector>
+
+#include <gf/Id.h>
+
+#include "Database.h"
+#include "Seed.h"
+#include "Tileset.h"
+
+namespace tlgn {
+
+  // a tileset to compute: its category, its biomes and its random streams
+  struct TilesetPlan {
+    TilesetSeed seed;
+    std::array<gf::Id, 3> biomes;
+  };
+
+  std::vector<TilesetPlan> planTilesets(SeedCategory category, uint64_t seed, const Database& db);
+
+  // generate and colorize the tileset
+  Tileset computeTileset(const TilesetPlan& plan, const Database& db);
+
+}
+
+#endif // TILEGEN_PLAN_H
@@ -0,0 +1,348 @@
+#include "Png.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "Profile.h"
+
+namespace tlgn {
+
+  namespace {
+
+    constexpr int BytesPerPixel = 4;
+    constexpr std::size_t WindowSize = 32 * 1024;
+    // big enough for deflate to find its matches, small enough to share the work
+    constexpr std::size_t BandTargetSize = 256 * 1024;
+
+    enum PngFilter : uint8_t {
+      None = 0,
+      Sub = 1,
+      Up = 2,
+      Average = 3,
+      Paeth = 4,
+    };
+
+    uint8_t paeth(int a, int b, int c) {
+      int p = a + b - c;
+      int pa = std::abs(p - a);
+      int pb = std::abs(p - b);
+      int pc = std::abs(p - c);
+
+      if (pa <= pb && pa <= pc) {
+        return static_cast<uint8_t>(a);
+      }
+
+      if (pb <= pc) {
+        return static_cast<uint8_t>(b);
+      }
+
+      return static_cast<uint8_t>(c);
+    }
+
+    // sum of the filtered bytes seen as signed values, the usual heuristic to choose a filter
+    unsigned computeCost(const uint8_t *data, std::size_t size) {
+      unsigned cost = 0;
+
+      for (std::size_t i = 0; i < size; ++i) {
+        cost += static_cast<unsigned>(std::abs(static_cast<int8_t>(data[i])));
+      }
+
+      return cost;
+    }
+
+    void filterRow(PngFilter filter, const uint8_t *row, const uint8_t *previous, std::size_t size, uint8_t *out) {
+      switch (filter) {
+        case None:
+          std::copy_n(row, size, out);
+          break;
+
+        case Sub:
+          for (std::size_t i = 0; i < size; ++i) {
+            uint8_t left = i >= BytesPerPixel ? row[i - BytesPerPixel] : 0;
+            out[i] = static_cast<uint8_t>(row[i] - left);
+          }
+          break;
+
+        case Up:
+          for (std::size_t i = 0; i < size; ++i) {
+            out[i] = static_cast<uint8_t>(row[i] - previous[i]);
+          }
+          break;
+
+        case Average:
+          for (std::size_t i = 0; i < size; ++i) {
+            int left = i >= BytesPerPixel ? row[i - BytesPerPixel] : 0;
+            out[i] = static_cast<uint8_t>(row[i] - ((left + previous[i]) >> 1));
+          }
+          break;
+
+        case Paeth:
+          for (std::size_t i = 0; i < size; ++i) {
+            int left = i >= BytesPerPixel ? row[i - BytesPerPixel] : 0;
+            int upLeft = i >= BytesPerPixel ? previous[i - BytesPerPixel] : 0;
+            out[i] = static_cast<uint8_t>(row[i] - paeth(left, previous[i], upLeft));
+          }
+          break;
+      }
+    }
+
+    // the filter byte followed by the filtered row, with the filter of least cost
+    void filterBestRow(const uint8_t *row, const uint8_t *previous, std::size_t size, std::vector<uint8_t>& candidate, uint8_t *out) {
+      static constexpr PngFilter Filters[] = { None, Sub, Up, Average, Paeth };
+
+      unsigned bestCost = 0;
+      bool first = true;
+
+      for (auto filter : Filters) {
+        filterRow(filter, row, previous, size, candidate.data());
+        unsigned cost = computeCost(candidate.data(), size);
+
+        if (first || cost < bestCost) {
+          first = false;
+          bestCost = cost;
+          out[0] = filter;
+          std::copy_n(candidate.data(), size, out + 1);
+        }
+      }
+    }
+
+    struct Band {
+      int rowBegin;
+      int rowEnd;
+      std::vector<uint8_t> filtered;
+      std::vector<uint8_t> compressed;
+      uLong adler;
+      bool ok;
+    };
+
+    // the band may refer to the data before it, like a single stream would
+    void deflateBand(Band& band, const std::vector<uint8_t>& before, int level) {
+      z_stream stream = {};
+      band.ok = false;
+
+      // raw deflate, the zlib header and checksum are written once for the whole stream
+      if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return;
+      }
+
+      if (!before.empty() && level > 0) {
+        std::size_t size = std::min(before.size(), WindowSize);
+        deflateSetDictionary(&stream, before.data() + before.size() - size, static_cast<uInt>(size));
+      }
+
+      band.compressed.resize(deflateBound(&stream, static_cast<uLong>(band.filtered.size())) + 16);
+
+      stream.next_in = band.filtered.data();
+      stream.avail_in = static_cast<uInt>(band.filtered.size());
+      stream.next_out = band.compressed.data();
+      stream.avail_out = static_cast<uInt>(band.compressed.size());
+
+      // a sync flush ends the band on a byte boundary without ending the stream
+      int status = deflate(&stream, Z_SYNC_FLUSH);
+      band.ok = status == Z_OK && stream.avail_in == 0;
+
+      band.compressed.resize(stream.total_out);
+      deflateEnd(&stream);
+
+      band.adler = adler32(adler32(0L, Z_NULL, 0), band.filtered.data(), static_cast<uInt>(band.filtered.size()));
+    }
+
+    void appendUint32(std::vector<uint8_t>& data, uint32_t value) {
+      data.push_back(static_cast<uint8_t>((value >> 24) & 0xFF));
+      data.push_back(static_cast<uint8_t>((value >> 16) & 0xFF));
+      data.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+      data.push_back(static_cast<uint8_t>(value & 0xFF));
+    }
+
+  }
+
+  /*
+   * Like pigz: the rows are cut in bands that are filtered and deflated
+   * independently, each band ending with a sync flush, and the compressed
+   * bands are concatenated in a single zlib stream. Each band uses the end
+   * of the previous one as dictionary, so the compression is close to a
+   * single-threaded encoder.
+   */
+  PngWriter::PngWriter(const gf::Path& filename, gf::Vector2i size, int level, ThreadPool& pool)
+  : m_filename(filename)
+  , m_size(size)
+  , m_level(level)
+  , m_pool(pool)
+  , m_os(filename.string(), std::ios::binary)
+  , m_ok(true)
+  , m_rows(0)
+  , m_previousRow(static_cast<std::size_t>(size.width) * BytesPerPixel, 0)
+  , m_adler(adler32(0L, Z_NULL, 0))
+  {
+    assert(0 <= level && level <= 9);
+
+    if (!m_os) {
+      std::cerr << "Could not open the image file: " << filename.string() << '\n';
+      m_ok = false;
+      return;
+    }
+
+    static constexpr uint8_t Signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    m_os.write(reinterpret_cast<const char *>(Signature), sizeof Signature);
+
+    std::vector<uint8_t> header;
+    appendUint32(header, static_cast<uint32_t>(size.width));
+    appendUint32(header, static_cast<uint32_t>(size.height));
+    header.push_back(8); // bit depth
+    header.push_back(6); // RGBA
+    header.push_back(0); // deflate
+    header.push_back(0); // adaptive filtering
+    header.push_back(0); // no interlace
+    writeChunk("IHDR", header.data(), header.size());
+
+    // the zlib header, the level is only informative
+    const uint8_t cmf = 0x78;
+    const uint8_t flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    uint8_t flg = static_cast<uint8_t>(flevel << 6);
+    flg = static_cast<uint8_t>(flg + 31 - (cmf * 256 + flg) % 31);
+
+    // the IDAT chunks are seen as a single stream by the decoder
+    const uint8_t zlibHeader[2] = { cmf, flg };
+    writeChunk("IDAT", zlibHeader, sizeof zlibHeader);
+  }
+
+  void PngWriter::appendRows(const gf::Color4u *rows, int count) {
+    assert(m_rows + count <= m_size.height);
+
+    if (!m_ok || count <= 0) {
+      return;
+    }
+
+    ProfileScope scope(Phase::Png);
+
+    const uint8_t *pixels = reinterpret_cast<const uint8_t *>(rows);
+    const std::size_t stride = static_cast<std::size_t>(m_size.width) * BytesPerPixel;
+
+    int rowsPerBand = static_cast<int>(std::max(BandTargetSize / std::max(stride, std::size_t(1)), std::size_t(1)));
+    int bandCount = (count + rowsPerBand - 1) / rowsPerBand;
+
+    std::vector<Band> bands(bandCount);
+
+    for (int i = 0; i < bandCount; ++i) {
+      bands[i].rowBegin = i * rowsPerBand;
+      bands[i].rowEnd = std::min((i + 1) * rowsPerBand, count);
+    }
+
+    m_pool.parallelFor(bands.size(), [&](std::size_t i) {
+      auto& band = bands[i];
+      band.filtered.resize((band.rowEnd - band.rowBegin) * (stride + 1));
+
+      std::vector<uint8_t> candidate(stride);
+
+      for (int y = band.rowBegin; y < band.rowEnd; ++y) {
+        const uint8_t *row = pixels + y * stride;
+        const uint8_t *previous = y > 0 ? row - stride : m_previousRow.data();
+        filterBestRow(row, previous, stride, candidate, band.filtered.data() + (y - band.rowBegin) * (stride + 1));
+      }
+    });
+
+    m_pool.parallelFor(bands.size(), [&](std::size_t i) {
+      deflateBand(bands[i], i > 0 ? bands[i - 1].filtered : m_window, m_level);
+    });
+
+    for (auto& band : bands) {
+      if (!band.ok) {
+        std::cerr << "Could not compress the image: " << m_filename.string() << '\n';
+        m_ok = false;
+        return;
+      }
+
+      writeChunk("IDAT", band.compressed.data(), band.compressed.size());
+      m_adler = adler32_combine(m_adler, band.adler, static_cast<z_off_t>(band.filtered.size()));
+
+      // keep the end of the data as the dictionary of the next rows
+      m_window.insert(m_window.end(), band.filtered.begin(), band.filtered.end());
+
+      if (m_window.size() > WindowSize) {
+        m_window.erase(m_window.begin(), m_window.end() - WindowSize);
+      }
+    }
+
+    std::copy_n(pixels + (count - 1) * stride, stride, m_previousRow.begin());
+    m_rows += count;
+  }
+
+  bool PngWriter::finish() {
+    if (!m_ok) {
+      return false;
+    }
+
+    if (m_rows != m_size.height) {
+      std::cerr << "Missing rows in the image: " << m_filename.string() << '\n';
+      return false;
+    }
+
+    ProfileScope scope(Phase::Png);
+
+    // an empty final block ends the deflate stream
+    z_stream stream = {};
+    uint8_t end[16];
+
+    if (deflateInit2(&stream, m_level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      return false;
+    }
+
+    stream.next_out = end;
+    stream.avail_out = sizeof end;
+    int status = deflate(&stream, Z_FINISH);
+    std::size_t size = stream.total_out;
+    deflateEnd(&stream);
+
+    if (status != Z_STREAM_END) {
+      return false;
+    }
+
+    std::vector<uint8_t> trailer(end, end + size);
+    appendUint32(trailer, static_cast<uint32_t>(m_adler));
+    writeChunk("IDAT", trailer.data(), trailer.size());
+    writeChunk("IEND", nullptr, 0);
+
+    m_os.close();
+
+    if (!m_os) {
+      std::cerr << "Could not write the image file: " << m_filename.string() << '\n';
+      return false;
+    }
+
+    return true;
+  }
+
+  void PngWriter::writeChunk(const char *type, const uint8_t *data, std::size_t size) {
+    std::vector<uint8_t> length;
+    appendUint32(length, static_cast<uint32_t>(size));
+    m_os.write(reinterpret_cast<const char *>(length.data()), length.size());
+    m_os.write(type, 4);
+    m_os.write(reinterpret_cast<const char *>(data), size);
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef *>(type), 4);
+
+    if (size > 0) {
+      // a null buffer would reset the crc
+      crc = crc32(crc, data, static_cast<uInt>(size));
+    }
+
+    std::vector<uint8_t> checksum;
+    appendUint32(checksum, static_cast<uint32_t>(crc));
+    m_os.write(reinterpret_cast<const char *>(checksum.data()), checksum.size());
+  }
+
+  bool writePng(const Texels& image, const gf::Path& filename, int level, ThreadPool& pool) {
+    PngWriter writer(filename, image.getSize(), level, pool);
+    writer.appendRows(image.getDataPtr(), image.getSize().height);
+    return writer.finish();
+  }
+
+}
@@ -0,0 +1,59 @@
+#ifndef TILEGEN_PNG_H
+#define TILEGEN_PNG_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+#include <gf/Path.h>
+#include <gf/Vector.h>
+
+#include <zlib.h>
+
+#include "ThreadPool.h"
+#include "Tile.h"
+
+namespace tlgn {
+
+  constexpr int DefaultPngLevel = 6;
+
+  /*
+   * An RGBA PNG written incrementally: the rows are appended from top to
+   * bottom and encoded as soon as they are given, so the whole image never
+   * needs to be in memory. level is the zlib level, from 0 (no compression)
+   * to 9 (best).
+   */
+  class PngWriter {
+  public:
+    PngWriter(const gf::Path& filename, gf::Vector2i size, int level, ThreadPool& pool);
+
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    // count rows of the width of the image
+    void appendRows(const gf::Color4u *rows, int count);
+
+    bool finish();
+
+  private:
+    void writeChunk(const char *type, const uint8_t *data, std::size_t size);
+
+  private:
+    gf::Path m_filename;
+    gf::Vector2i m_size;
+    int m_level;
+    ThreadPool& m_pool;
+    std::ofstream m_os;
+    bool m_ok;
+
+    int m_rows;
+    std::vector<uint8_t> m_previousRow;
+    std::vector<uint8_t> m_window;
+    uLong m_adler;
+  };
+
+  bool writePng(const Texels& image, const gf::Path& filename, int level, ThreadPool& pool);
+
+}
+
+#endif // TILEGEN_PNG_H
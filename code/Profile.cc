@@ -0,0 +1,161 @@
+#include "Profile.h"
+
+#include <fstream>
+#include <iostream>
+
+namespace tlgn {
+
+  namespace {
+
+    const char *PhaseNames[PhaseCount] = {
+      "load",
+      "geometry",
+      "colorize",
+      "border",
+      "blit",
+      "png",
+      "tsx",
+    };
+
+    const char *CounterNames[CounterCount] = {
+      "tiles",
+      "pixels",
+      "border_pixels",
+    };
+
+    unsigned getThreadNumber() {
+      static std::atomic<unsigned> next(0);
+      thread_local unsigned number = next.fetch_add(1);
+      return number;
+    }
+
+    double toMicroseconds(Profiler::Clock::duration duration) {
+      return std::chrono::duration<double, std::micro>(duration).count();
+    }
+
+    // the innermost scope of the thread
+    thread_local ProfileScope *g_currentScope = nullptr;
+
+  }
+
+  Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  Profiler::Profiler()
+  : m_start(Clock::now())
+  , m_trace(false)
+  {
+    for (auto& calls : m_calls) {
+      calls.store(0);
+    }
+
+    for (auto& nanoseconds : m_nanoseconds) {
+      nanoseconds.store(0);
+    }
+
+    for (auto& counter : m_counters) {
+      counter.store(0);
+    }
+  }
+
+  void Profiler::enableTrace() {
+    m_trace = true;
+  }
+
+  void Profiler::addSpan(Phase phase, const char *name, Clock::time_point start, Clock::time_point end, Clock::duration nested) {
+    auto index = static_cast<std::size_t>(phase);
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start - nested);
+
+    m_calls[index].fetch_add(1, std::memory_order_relaxed);
+    m_nanoseconds[index].fetch_add(static_cast<uint64_t>(duration.count()), std::memory_order_relaxed);
+
+    if (!m_trace) {
+      return;
+    }
+
+    unsigned thread = getThreadNumber();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spans.push_back({ name != nullptr ? name : PhaseNames[index], phase, start, end, thread });
+  }
+
+  bool Profiler::writeStats(const gf::Path& filename) const {
+    std::ofstream os(filename.string());
+
+    if (!os) {
+      std::cerr << "Could not open the stats file: " << filename.string() << '\n';
+      return false;
+    }
+
+    os << "{\n";
+    os << "  \"wall_ms\": " << toMicroseconds(Clock::now() - m_start) / 1000.0 << ",\n";
+    os << "  \"phases\": {\n";
+
+    for (std::size_t i = 0; i < PhaseCount; ++i) {
+      os << "    \"" << PhaseNames[i] << "\": { \"calls\": " << m_calls[i].load() << ", \"total_ms\": " << m_nanoseconds[i].load() / 1e6 << " }" << (i + 1 < PhaseCount ? "," : "") << '\n';
+    }
+
+    os << "  },\n";
+    os << "  \"counters\": {\n";
+
+    for (std::size_t i = 0; i < CounterCount; ++i) {
+      os << "    \"" << CounterNames[i] << "\": " << m_counters[i].load() << (i + 1 < CounterCount ? "," : "") << '\n';
+    }
+
+    os << "  }\n";
+    os << "}\n";
+
+    return static_cast<bool>(os);
+  }
+
+  bool Profiler::writeTrace(const gf::Path& filename) const {
+    std::ofstream os(filename.string());
+
+    if (!os) {
+      std::cerr << "Could not open the trace file: " << filename.string() << '\n';
+      return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // see the Trace Event Format, complete events have a start and a duration in microseconds
+    os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    os << std::fixed;
+    os.precision(3);
+
+    for (std::size_t i = 0; i < m_spans.size(); ++i) {
+      auto& span = m_spans[i];
+      os << "{\"name\":\"" << span.name << "\",\"cat\":\"" << PhaseNames[static_cast<std::size_t>(span.phase)] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread;
+      os << ",\"ts\":" << toMicroseconds(span.start - m_start) << ",\"dur\":" << toMicroseconds(span.end - span.start) << '}';
+      os << (i + 1 < m_spans.size() ? ",\n" : "\n");
+    }
+
+    os << "]}\n";
+
+    return static_cast<bool>(os);
+  }
+
+  ProfileScope::ProfileScope(Phase phase, const char *name)
+  : m_phase(phase)
+  , m_name(name)
+  , m_start(Profiler::Clock::now())
+  , m_nested(Profiler::Clock::duration::zero())
+  , m_parent(g_currentScope)
+  {
+    g_currentScope = this;
+  }
+
+  ProfileScope::~ProfileScope() {
+    auto end = Profiler::Clock::now();
+    Profiler::get().addSpan(m_phase, m_name, m_start, end, m_nested);
+
+    if (m_parent != nullptr) {
+      m_parent->m_nested += end - m_start;
+    }
+
+    g_currentScope = m_parent;
+  }
+
+}
@@ -0,0 +1,106 @@
+#ifndef TILEGEN_PROFILE_H
+#define TILEGEN_PROFILE_H
+
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include <gf/Path.h>
+
+namespace tlgn {
+
+  enum class Phase : std::size_t {
+    Load,
+    Geometry,
+    Colorize,
+    Border,
+    Blit,
+    Png,
+    Tsx,
+  };
+
+  constexpr std::size_t PhaseCount = 7;
+
+  enum class Counter : std::size_t {
+    Tiles,
+    Pixels,
+    BorderPixels,
+  };
+
+  constexpr std::size_t CounterCount = 3;
+
+  /*
+   * Time spent in each phase, summed over all the threads, and some counters.
+   * The time of a phase does not include the phases nested in it on the same
+   * thread (the border of a tile in its colorization), so that the totals do
+   * not count a time twice. When the trace is enabled, every scope is also
+   * recorded as a span, to be seen in chrome://tracing or Perfetto.
+   */
+  class Profiler {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    static Profiler& get();
+
+    void enableTrace();
+
+    bool isTraceEnabled() const {
+      return m_trace;
+    }
+
+    // nested is the time of the phases nested in the span, it is not counted in the phase
+    void addSpan(Phase phase, const char *name, Clock::time_point start, Clock::time_point end, Clock::duration nested);
+
+    void count(Counter counter, uint64_t value = 1) {
+      m_counters[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    bool writeStats(const gf::Path& filename) const;
+    bool writeTrace(const gf::Path& filename) const;
+
+  private:
+    Profiler();
+
+    struct Span {
+      const char *name;
+      Phase phase;
+      Clock::time_point start;
+      Clock::time_point end;
+      unsigned thread;
+    };
+
+  private:
+    Clock::time_point m_start;
+    bool m_trace;
+
+    std::array<std::atomic<uint64_t>, PhaseCount> m_calls;
+    std::array<std::atomic<uint64_t>, PhaseCount> m_nanoseconds;
+    std::array<std::atomic<uint64_t>, CounterCount> m_counters;
+
+    mutable std::mutex m_mutex;
+    std::vector<Span> m_spans;
+  };
+
+  // measures the time of a scope, name is the name of the span in the trace (the phase by default)
+  class ProfileScope {
+  public:
+    explicit ProfileScope(Phase phase, const char *name = nullptr);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+  private:
+    Phase m_phase;
+    const char *m_name;
+    Profiler::Clock::time_point m_start;
+    Profiler::Clock::duration m_nested;
+    ProfileScope *m_parent;
+  };
+
+}
+
+#endif // TILEGEN_PROFILE_H
@@ -0,0 +1,37 @@
+#include "Quantize.h"
+
+#include <cassert>
+#include <cstdint>
+#include <algorithm>
+
+#include <gf/VectorOps.h>
+
+namespace tlgn {
+
+  static_assert(sizeof(gf::Color4f) == 4 * sizeof(float), "Colors must be packed floats");
+  static_assert(sizeof(gf::Color4u) == 4 * sizeof(uint8_t), "Texels must be packed bytes");
+
+  /*
+   * The channels are processed as a flat array, without any call per pixel,
+   * so that the compiler turns the loop into packed conversions. Out of range
+   * values are clamped first, the conversion then truncates like toRgba32.
+   */
+  void quantizeColors(const gf::Color4f *colors, std::size_t count, gf::Color4u *texels) {
+    const float *in = reinterpret_cast<const float *>(colors);
+    uint8_t *out = reinterpret_cast<uint8_t *>(texels);
+
+    for (std::size_t i = 0; i < count * 4; ++i) {
+      float value = std::min(std::max(in[i], 0.0f), 1.0f);
+      out[i] = static_cast<uint8_t>(static_cast<int32_t>(value * 255.0f));
+    }
+  }
+
+  void quantizeColors(const Colors& colors, Texels& texels) {
+    if (texels.getSize() != colors.getSize()) {
+      texels = Texels(colors.getSize());
+    }
+
+    quantizeColors(colors.getDataPtr(), colors.getDataSize(), texels.begin());
+  }
+
+}
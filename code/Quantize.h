@@ -0,0 +1,19 @@
+#ifndef TILEGEN_QUANTIZE_H
+#define TILEGEN_QUANTIZE_H
+
+#include <cstddef>
+
+#include <gf/Color.h>
+
+#include "Tile.h"
+
+namespace tlgn {
+
+  // same conversion as gf::Color::toRgba32, for a whole run of colors
+  void quantizeColors(const gf::Color4f *colors, std::size_t count, gf::Color4u *texels);
+
+  void quantizeColors(const Colors& colors, Texels& texels);
+
+}
+
+#endif // TILEGEN_QUANTIZE_H
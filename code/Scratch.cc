@@ -0,0 +1,105 @@
+#include "Scratch.h"
+
+#include <atomic>
+
+#include <gf/VectorOps.h>
+
+namespace tlgn {
+
+  namespace {
+
+    std::atomic<std::size_t> g_tiles(0);
+    std::atomic<std::size_t> g_allocations(0);
+
+  }
+
+  void countScratchAllocation() {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Scratch& Scratch::getLocal() {
+    thread_local Scratch scratch;
+    return scratch;
+  }
+
+  ScratchStats Scratch::getStats() {
+    return { g_tiles.load(), g_allocations.load() };
+  }
+
+  ScratchVector<gf::Vector2i>& Scratch::getLinePoints() {
+    m_linePoints.clear();
+    return m_linePoints;
+  }
+
+  ScratchVector<gf::Vector2i>& Scratch::getFillSeeds() {
+    m_fillSeeds.clear();
+    return m_fillSeeds;
+  }
+
+  Colors& Scratch::getColors(gf::Vector2i size) {
+    if (m_colors.getSize() != size) {
+      countScratchAllocation();
+      m_colors = Colors(size);
+    }
+
+    return m_colors;
+  }
+
+  Colors& Scratch::getBlurRows(gf::Vector2i size) {
+    if (m_blurRows.getSize() != size) {
+      countScratchAllocation();
+      m_blurRows = Colors(size);
+    }
+
+    return m_blurRows;
+  }
+
+  Colors& Scratch::getBlurredColors(gf::Vector2i size) {
+    if (m_blurredColors.getSize() != size) {
+      countScratchAllocation();
+      m_blurredColors = Colors(size);
+    }
+
+    return m_blurredColors;
+  }
+
+  Distances& Scratch::getDistances(gf::Vector2i size) {
+    if (m_distances.getSize() != size) {
+      countScratchAllocation();
+      m_distances = Distances(size);
+    }
+
+    return m_distances;
+  }
+
+  ScratchVector<float>& Scratch::getDistanceValues() {
+    m_distanceValues.clear();
+    return m_distanceValues;
+  }
+
+  ScratchVector<int>& Scratch::getDistanceVertices() {
+    m_distanceVertices.clear();
+    return m_distanceVertices;
+  }
+
+  const ScratchVector<uint8_t>& Scratch::getStripes(int size) {
+    if (m_stripesSize != size) {
+      m_stripes.resize(static_cast<std::size_t>(size) * size);
+
+      for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+          m_stripes[j * size + i] = Pigment::isInStripe({ i, j }) ? 1 : 0;
+        }
+      }
+
+      m_stripesSize = size;
+    }
+
+    return m_stripes;
+  }
+
+  void Scratch::finishTile() {
+    g_tiles.fetch_add(1, std::memory_order_relaxed);
+  }
+
+}
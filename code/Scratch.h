@@ -0,0 +1,99 @@
+#ifndef TILEGEN_SCRATCH_H
+#define TILEGEN_SCRATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <gf/Vector.h>
+
+#include "Distance.h"
+#include "Tile.h"
+
+namespace tlgn {
+
+  void countScratchAllocation();
+
+  // a standard allocator that reports its allocations in the scratch statistics
+  template<typename T>
+  struct ScratchAllocator {
+    using value_type = T;
+
+    ScratchAllocator() = default;
+
+    template<typename U>
+    ScratchAllocator(const ScratchAllocator<U>&) {
+    }
+
+    T *allocate(std::size_t n) {
+      countScratchAllocation();
+      return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+      std::allocator<T>().deallocate(p, n);
+    }
+  };
+
+  template<typename T, typename U>
+  bool operator==(const ScratchAllocator<T>&, const ScratchAllocator<U>&) {
+    return true;
+  }
+
+  template<typename T, typename U>
+  bool operator!=(const ScratchAllocator<T>&, const ScratchAllocator<U>&) {
+    return false;
+  }
+
+  template<typename T>
+  using ScratchVector = std::vector<T, ScratchAllocator<T>>;
+
+  struct ScratchStats {
+    std::size_t tiles;
+    std::size_t allocations;
+  };
+
+  /*
+   * Per-thread buffers for the short-lived data of a tile (frontier points,
+   * fill seeds, border colors, distances, blur rows and stripes). The buffers keep their capacity, so once a
+   * thread is warmed up, generating a tile does not allocate from them.
+   *
+   * The vectors of gf::midpointDisplacement1D and gf::generateLine are still
+   * allocated for each segment of a frontier, they are counted with the
+   * scratch allocations.
+   */
+  class Scratch {
+  public:
+    static Scratch& getLocal();
+    static ScratchStats getStats();
+
+    ScratchVector<gf::Vector2i>& getLinePoints();
+    ScratchVector<gf::Vector2i>& getFillSeeds();
+    Colors& getColors(gf::Vector2i size);
+    Colors& getBlurRows(gf::Vector2i size);
+    Colors& getBlurredColors(gf::Vector2i size);
+    Distances& getDistances(gf::Vector2i size);
+    ScratchVector<float>& getDistanceValues();
+    ScratchVector<int>& getDistanceVertices();
+    // the mask of the Striped pigment, size x size, kept between the tiles
+    const ScratchVector<uint8_t>& getStripes(int size);
+
+    void finishTile();
+
+  private:
+    ScratchVector<gf::Vector2i> m_linePoints;
+    ScratchVector<gf::Vector2i> m_fillSeeds;
+    Colors m_colors;
+    Colors m_blurRows;
+    Colors m_blurredColors;
+    Distances m_distances;
+    ScratchVector<float> m_distanceValues;
+    ScratchVector<int> m_distanceVertices;
+    ScratchVector<uint8_t> m_stripes;
+    int m_stripesSize = 0;
+  };
+
+}
+
+#endif // TILEGEN_SCRATCH_H
@@ -0,0 +1,72 @@
+#include "Seed.h"
+
+#include <cassert>
+#include <random>
+
+namespace tlgn {
+
+  namespace {
+
+    constexpr uint64_t Gamma = UINT64_C(0x9E3779B97F4A7C15);
+
+    // finalizer of SplitMix64
+    constexpr uint64_t mix(uint64_t x) {
+      x = (x ^ (x >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+      x = (x ^ (x >> 27)) * UINT64_C(0x94D049BB133111EB);
+      return x ^ (x >> 31);
+    }
+
+    constexpr uint64_t combine(uint64_t key, uint64_t counter) {
+      return mix(key + (counter + 1) * Gamma);
+    }
+
+  }
+
+  gf::Vector2i getTilesetSize(SeedCategory category) {
+    switch (category) {
+      case SeedCategory::Plain:
+      case SeedCategory::TwoCorners:
+      case SeedCategory::Overlay:
+        return { 4, 4 };
+      case SeedCategory::ThreeCorners:
+        return { 9, 4 };
+    }
+
+    assert(false);
+    return { 0, 0 };
+  }
+
+  uint64_t TilesetSeed::computeTileSeed(gf::Vector2i position, SeedPurpose purpose) const {
+    uint64_t key = mix(seed);
+    key = combine(key, static_cast<uint64_t>(category));
+    key = combine(key, static_cast<uint64_t>(index));
+    key = combine(key, static_cast<uint32_t>(position.x));
+    key = combine(key, static_cast<uint32_t>(position.y));
+    key = combine(key, static_cast<uint64_t>(purpose));
+    return key;
+  }
+
+  gf::Random TilesetSeed::getTileRandom(gf::Vector2i position, SeedPurpose purpose) const {
+    uint64_t key = computeTileSeed(position, purpose);
+    // the engine may only use the lower bits of the seed
+    return gf::Random(key ^ (key >> 32));
+  }
+
+  gf::Random getTerrainRandom(uint64_t seed, const std::array<gf::Id, 4>& terrain, uint64_t variant, SeedPurpose purpose) {
+    uint64_t key = mix(seed);
+
+    for (auto biome : terrain) {
+      key = combine(key, biome);
+    }
+
+    key = combine(key, variant);
+    key = combine(key, static_cast<uint64_t>(purpose));
+    return gf::Random(key ^ (key >> 32));
+  }
+
+  uint64_t computeDefaultSeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) | device();
+  }
+
+}
@@ -0,0 +1,51 @@
+#ifndef TILEGEN_SEED_H
+#define TILEGEN_SEED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#include <gf/Id.h>
+#include <gf/Random.h>
+#include <gf/Vector.h>
+
+namespace tlgn {
+
+  enum class SeedCategory : uint64_t {
+    Plain,
+    TwoCorners,
+    ThreeCorners,
+    Overlay,
+  };
+
+  // the number of tiles in a tileset of the category
+  gf::Vector2i getTilesetSize(SeedCategory category);
+
+  enum class SeedPurpose : uint64_t {
+    Geometry,
+    Colors,
+  };
+
+  /*
+   * Identifies a tileset in a generation. Every tile gets its own random
+   * stream, derived from (seed, category, index, position, purpose) with a
+   * counter-based mix, so that a tile does not depend on the order in which
+   * the tiles are processed.
+   */
+  struct TilesetSeed {
+    uint64_t seed;
+    SeedCategory category;
+    std::size_t index;
+
+    uint64_t computeTileSeed(gf::Vector2i position, SeedPurpose purpose) const;
+    gf::Random getTileRandom(gf::Vector2i position, SeedPurpose purpose) const;
+  };
+
+  // the random stream of a tile generated on its own, from its corners and a variant
+  gf::Random getTerrainRandom(uint64_t seed, const std::array<gf::Id, 4>& terrain, uint64_t variant, SeedPurpose purpose);
+
+  uint64_t computeDefaultSeed();
+
+}
+
+#endif // TILEGEN_SEED_H
@@ -28,6 +28,11 @@ namespace tlgn {
     std::string name;
     TileSettings tile;
     gf::Vector2i image;
+    gf::Vector2i page = { 0, 0 }; // size of the atlas pages, or zero for a single image
+
+    bool hasPages() const {
+      return page.width > 0 && page.height > 0;
+    }
   };
 
 } // namespace tlgn
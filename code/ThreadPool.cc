@@ -0,0 +1,116 @@
+#include "ThreadPool.h"
+
+#include <cassert>
+
+namespace tlgn {
+
+  ThreadPool::ThreadPool(unsigned jobs)
+  : m_func(nullptr)
+  , m_count(0)
+  , m_next(0)
+  , m_generation(0)
+  , m_active(0)
+  , m_stop(false)
+  {
+    if (jobs == 0) {
+      jobs = getDefaultJobs();
+    }
+
+    for (unsigned i = 1; i < jobs; ++i) {
+      m_workers.emplace_back(&ThreadPool::work, this);
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+    }
+
+    m_start.notify_all();
+
+    for (auto& worker : m_workers) {
+      worker.join();
+    }
+  }
+
+  void ThreadPool::parallelFor(std::size_t count, const std::function<void(std::size_t)>& func) {
+    if (m_workers.empty() || count <= 1) {
+      for (std::size_t i = 0; i < count; ++i) {
+        func(i);
+      }
+
+      return;
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      assert(m_active == 0);
+      m_func = &func;
+      m_count = count;
+      m_next = 0;
+      ++m_generation;
+    }
+
+    m_start.notify_all();
+
+    consume();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_finish.wait(lock, [this]() { return m_active == 0; });
+    m_func = nullptr;
+    m_count = 0;
+  }
+
+  unsigned ThreadPool::getDefaultJobs() {
+    unsigned jobs = std::thread::hardware_concurrency();
+    return jobs > 0 ? jobs : 1;
+  }
+
+  void ThreadPool::work() {
+    unsigned generation = 0;
+
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_start.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+
+        if (m_stop) {
+          return;
+        }
+
+        generation = m_generation;
+
+        // the batch may be over before this worker wakes up, the next one is announced by a new generation
+        if (m_func == nullptr) {
+          continue;
+        }
+
+        ++m_active;
+      }
+
+      consume();
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        --m_active;
+      }
+
+      m_finish.notify_all();
+    }
+  }
+
+  // m_func and m_count do not change while a thread is active
+  void ThreadPool::consume() {
+    for (;;) {
+      std::size_t i = m_next++;
+
+      if (i >= m_count) {
+        return;
+      }
+
+      (*m_func)(i);
+    }
+  }
+
+}
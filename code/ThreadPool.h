@@ -0,0 +1,53 @@
+#ifndef TILEGEN_THREAD_POOL_H
+#define TILEGEN_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tlgn {
+
+  class ThreadPool {
+  public:
+    // jobs is the total number of threads, including the calling thread
+    explicit ThreadPool(unsigned jobs = getDefaultJobs());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned getJobs() const {
+      return static_cast<unsigned>(m_workers.size()) + 1;
+    }
+
+    // calls func(i) for every i in [0, count) and waits for all the calls to finish
+    void parallelFor(std::size_t count, const std::function<void(std::size_t)>& func);
+
+    static unsigned getDefaultJobs();
+
+  private:
+    void work();
+    void consume();
+
+  private:
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_finish;
+
+    const std::function<void(std::size_t)> *m_func;
+    std::size_t m_count;
+    std::atomic<std::size_t> m_next;
+    unsigned m_generation;
+    unsigned m_active;
+    bool m_stop;
+  };
+
+}
+
+#endif // TILEGEN_THREAD_POOL_H
@@ -1,13 +1,51 @@
 #include "Tile.h"
 
+#include <algorithm>
+
 #include <gf/Color.h>
 #include <gf/Unused.h>
 #include <gf/VectorOps.h>
 
+#include "Blur.h"
+#include "Colorize.h"
+#include "Distance.h"
+#include "Profile.h"
+#include "Quantize.h"
+#include "Scratch.h"
+
 namespace tlgn {
 
   namespace {
 
+    constexpr float BlurDistance = 5.0f;
+
+    // copies the sides of the tile in its spacing, the corners come from the extruded rows
+    template<typename T>
+    void extrudeSpacing(gf::Array2D<T, int>& array, int size, int spacing) {
+      if (spacing == 0) {
+        return;
+      }
+
+      auto dims = array.getSize();
+
+      assert(dims.width == size + 2 * spacing);
+      assert(dims.height == size + 2 * spacing);
+
+      for (int j = 0; j < spacing; ++j) {
+        // top
+        std::copy_n(&array({ spacing, spacing }), size, &array({ spacing, j }));
+        // bottom
+        std::copy_n(&array({ spacing, dims.height - spacing - 1 }), size, &array({ spacing, dims.height - j - 1 }));
+      }
+
+      for (int i = 0; i < dims.height; ++i) {
+        // left
+        std::fill_n(&array({ 0, i }), spacing, array({ spacing, i }));
+        // right
+        std::fill_n(&array({ dims.width - spacing, i }), spacing, array({ dims.width - spacing - 1, i }));
+      }
+    }
+
     gf::Direction rotateDirection(gf::Direction dir) {
       switch (dir) {
         case gf::Direction::Up:
@@ -28,13 +66,37 @@ namespace tlgn {
 
   }
 
+  PaletteIndex Palette::add(gf::Id id) {
+    PaletteIndex index = find(id);
+
+    if (index != InvalidIndex) {
+      return index;
+    }
+
+    assert(count < 4);
+    biome[count] = id;
+    return static_cast<PaletteIndex>(count++);
+  }
+
+  PaletteIndex Palette::find(gf::Id id) const {
+    for (int i = 0; i < count; ++i) {
+      if (biome[i] == id) {
+        return static_cast<PaletteIndex>(i);
+      }
+    }
+
+    return InvalidIndex;
+  }
+
   Tile::Tile(const TileSettings& settings, gf::Id biome)
   : size(settings.size)
   , spacing(settings.spacing)
-  , pixels(settings.getTileSize(), biome)
+  , pixels(settings.getTileSize(), biome == gf::InvalidId ? InvalidIndex : palette.add(biome))
   , colors(settings.getExtendedTileSize())
   , terrain({ gf::InvalidId, gf::InvalidId, gf::InvalidId, gf::InvalidId })
   , id(-1)
+  , page(0)
+  , orientation(0)
   {
     fences.count = 0;
     borders.count = 0;
@@ -42,29 +104,49 @@ namespace tlgn {
 
   Tile::Tile(gf::NoneType)
   : size(0)
+  , spacing(0)
+  , id(-1)
+  , page(0)
+  , orientation(0)
   {
     fences.count = 0;
     borders.count = 0;
   }
 
-  void Tile::rotate(int quarters) {
-    int half = size / 2;
+  gf::Vector2i computeCanonicalPosition(gf::Vector2i pos, int extent, int quarters) {
+    switch (quarters & 3) {
+      case 1:
+        return { extent - 1 - pos.y, pos.x };
+      case 2:
+        return { extent - 1 - pos.x, extent - 1 - pos.y };
+      case 3:
+        return { pos.y, extent - 1 - pos.x };
+      default:
+        break;
+    }
 
-    for (int q = 0; q < quarters; ++q) {
-      for (int i = 0; i < half; ++i) {
-        int iprime = size - 1 - i;
+    return pos;
+  }
 
-        for (int j = 0; j < half; ++j) {
-          int jprime = size - 1 - j;
+  gf::Vector2i computeCanonicalStep(int quarters) {
+    switch (quarters & 3) {
+      case 1:
+        return { 0, 1 };
+      case 2:
+        return { -1, 0 };
+      case 3:
+        return { 0, -1 };
+      default:
+        break;
+    }
 
-          auto tmp = pixels({ i, j });
-          pixels({ i, j }) = pixels({ jprime, i });
-          pixels({ jprime, i }) = pixels({ iprime, jprime });
-          pixels({ iprime, jprime }) = pixels({ j, iprime });
-          pixels({ j, iprime }) = tmp;
-        }
-      }
+    return { 1, 0 };
+  }
+
+  void Tile::rotate(int quarters) {
+    orientation = (orientation + quarters) & 3;
 
+    for (int q = 0; q < quarters; ++q) {
       auto tmp = terrain[TerrainTopLeft];
       terrain[TerrainTopLeft] = terrain[TerrainTopRight];
       terrain[TerrainTopRight] = terrain[TerrainBottomRight];
@@ -79,56 +161,99 @@ namespace tlgn {
     }
   }
 
-  void Tile::colorize(const std::map<gf::Id, Biome>& biomes, gf::Random& random) {
-    checkPixels();
-    generateColors(biomes, random);
-    fillColorsBorder();
+  /*
+   * The finishing of a tile is done in few passes that stay in the cache:
+   * the pixels are repaired and colorized row by row, the border effects
+   * are applied in place when possible, and the spacing is extruded on the
+   * quantized texels rather than on the float colors.
+   */
+  void Tile::colorize(const Database& db, gf::Random& random) {
+    ColorTable table = computeColorTable(palette, db);
+    uint32_t key = computeColorKey(table, random);
+
+    for (int j = 0; j < size; ++j) {
+      checkPixelRow(j);
+      colorizeRow(pixels, j, orientation, spacing, table, key, colors);
+    }
+
     generateBorder();
-    fillColorsBorder();
+
+    // the float colors are only needed while the tile is computed
+    if (texels.getSize() != colors.getSize()) {
+      texels = Texels(colors.getSize());
+    }
+
+    for (int j = 0; j < size; ++j) {
+      quantizeColors(&colors({ spacing, j + spacing }), size, &texels({ spacing, j + spacing }));
+    }
+
+    extrudeSpacing(texels, size, spacing);
+    colors = Colors();
+
+    auto& profiler = Profiler::get();
+    profiler.count(Counter::Tiles);
+    profiler.count(Counter::Pixels, static_cast<uint64_t>(size) * size);
+
+    Scratch::getLocal().finishTile();
   }
 
-  void Tile::checkPixels() {
-    for (auto pos : pixels.getPositionRange()) {
-      gf::Id id = pixels(pos);
+  // the passes that depend on the order of the pixels walk the tile in its final orientation
+
+  void Tile::checkPixelRow(int row) {
+    const gf::Vector2i step = computeCanonicalStep(orientation);
+    const std::ptrdiff_t stride = step.x + step.y * size;
+    const PaletteIndex *in = &pixels(computeCanonicalPosition({ 0, row }, size, orientation));
+
+    bool invalid = false;
+
+    for (int i = 0; i < size; ++i) {
+      invalid |= (in[i * stride] == InvalidIndex);
+    }
+
+    if (!invalid) {
+      return;
+    }
 
-      if (id == gf::InvalidId) {
-        auto& invalid = pixels(pos);
+    // the rows below are not repaired yet, like in a walk pixel by pixel
 
+    for (int i = 0; i < size; ++i) {
+      gf::Vector2i pos = { i, row };
+      auto& index = pixels(computeCanonicalPosition(pos, size, orientation));
+
+      if (index == InvalidIndex) {
         for (auto next : pixels.get4NeighborsRange(pos)) {
-          gf::Id nextBiome = pixels(next);
+          PaletteIndex nextIndex = pixels(computeCanonicalPosition(next, size, orientation));
 
-          if (nextBiome != gf::InvalidId) {
-            invalid = nextBiome;
+          if (nextIndex != InvalidIndex) {
+            index = nextIndex;
           }
         }
       }
 
-      assert(pixels(pos) != gf::InvalidId);
+      assert(index != InvalidIndex);
     }
   }
 
-  void Tile::generateColors(const std::map<gf::Id, Biome>& biomes, gf::Random& random) {
-    for (auto pos : pixels.getPositionRange()) {
-      gf::Id id = pixels(pos);
+  void Tile::generateBorder() {
+    if (borders.count == 0) {
+      return;
+    }
 
-      if (id == Void) {
-        colors(pos + 1) = gf::Color4f(1.0f, 1.0f, 1.0f, 0.0f);
-        continue;
-      }
+    ProfileScope scope(Phase::Border);
+    uint64_t borderPixels = 0;
 
-      auto it = biomes.find(id);
+    auto& scratch = Scratch::getLocal();
 
-      if (it == biomes.end()) {
-        std::cerr << "Unknown id: " << std::hex << id << " at position " << std::dec << pos.x << ',' << pos.y << '\n';
-      }
+    const bool inPlace = canGenerateBorderInPlace();
+    Colors& newColors = inPlace ? colors : scratch.getColors(colors.getSize());
+    Colors& blurred = scratch.getBlurredColors(colors.getSize());
+    Distances& distances = scratch.getDistances(pixels.getSize());
 
-      assert(it != biomes.end());
-      colors(pos + 1) = it->second.pigment.getColor(random, pos);
+    if (!inPlace) {
+      // the blur reads the spacing
+      extrudeSpacing(colors, size, spacing);
+      std::copy(colors.begin(), colors.end(), newColors.begin());
     }
-  }
-
-  void Tile::generateBorder() {
-    Colors newColors(colors);
 
     for (int i = 0; i < borders.count; ++i) {
       auto& border = borders.border[i];
@@ -137,143 +262,143 @@ namespace tlgn {
         continue;
       }
 
-      for (auto pos : pixels.getPositionRange()) {
-        gf::Id id = pixels(pos);
+      PaletteIndex b1 = palette.find(border.b1);
+      PaletteIndex b2 = palette.find(border.b2);
+      PaletteIndex empty = palette.find(Void);
 
-        if (id == Void) {
-          continue;
-        }
+      // the distances to the other side of the border are computed once per side
+
+      const PaletteIndex sides[2][2] = { { b1, b2 }, { b2, b1 } };
 
-        gf::Id other = Void;
+      for (auto& side : sides) {
+        PaletteIndex index = side[0];
+        PaletteIndex other = side[1];
 
-        if (id == border.b1) {
-          other = border.b2;
-        } else if (id == border.b2) {
-          other = border.b1;
-        } else {
+        if (index == empty || index == InvalidIndex) {
           continue;
         }
 
-        int minDistance = size * 2;
+        computeDistances(pixels, other, border.metric, distances);
 
-        for (auto neighbor : pixels.getPositionRange()) {
-          if (pixels(neighbor) != other) {
+        if (border.effect == BorderEffect::Blur) {
+          // only the band of rows near the frontier is blurred
+          int ymin = size;
+          int ymax = -1;
+
+          for (auto pos : pixels.getPositionRange()) {
+            if (pixels(pos) == index && distances(pos) < BlurDistance) {
+              ymin = std::min(ymin, pos.y);
+              ymax = std::max(ymax, pos.y);
+            }
+          }
+
+          if (ymax < ymin) {
             continue;
           }
 
-          int distance = gf::manhattanDistance(pos, neighbor);
+          blurColors(colors, ymin + spacing, ymax + spacing, blurred);
+        }
 
-          if (distance < minDistance) {
-            minDistance = distance;
+        for (auto pos : pixels.getPositionRange()) {
+          if (pixels(pos) != index) {
+            continue;
           }
-        }
 
-        auto colorPos = pos + spacing;
-        auto color = colors(colorPos);
+          float minDistance = distances(pos);
 
-        switch (border.effect) {
-          case BorderEffect::Fade:
-            static constexpr int FadeDistance = 11;
+          auto colorPos = pos + spacing;
+          auto color = colors(colorPos);
 
-            if (minDistance < FadeDistance) {
-              color.a = gf::lerp(color.a, 0.0f, (FadeDistance - minDistance) / 10.0f);
-            }
+          switch (border.effect) {
+            case BorderEffect::Fade:
+              static constexpr int FadeDistance = 11;
 
-            break;
+              if (minDistance < FadeDistance) {
+                color.a = gf::lerp(color.a, 0.0f, (FadeDistance - minDistance) / 10.0f);
+              }
 
-          case BorderEffect::Outline:
-            if (minDistance <= 6) {
-              color = gf::Color::darker(color, 0.2f);
-            }
+              break;
 
-            break;
+            case BorderEffect::Outline:
+              if (minDistance <= 6) {
+                color = gf::Color::darker(color, 0.2f);
+              }
 
-          case BorderEffect::Sharpen:
-            static constexpr int SharpenDistance = 6;
+              break;
 
-            if (minDistance < SharpenDistance) {
-              color = gf::Color::darker(color, (SharpenDistance - minDistance) * 0.05);
-              color.a = gf::lerp(color.a, 1.0f, (SharpenDistance - minDistance) / 5.0f);
-            }
+            case BorderEffect::Sharpen:
+              static constexpr int SharpenDistance = 6;
 
-            break;
-
-          case BorderEffect::Blur:
-            if (minDistance < 5) {
-              // see https://en.wikipedia.org/wiki/Kernel_(image_processing)
-
-              float finalCoeff = 36.0f;
-              gf::Color4f finalColor = finalCoeff * colors(colorPos);
-
-              for (auto next : colors.get24NeighborsRange(colorPos)) {
-                gf::Color4f nextColor = colors(next);
-                gf::Vector2i diff = gf::abs(colorPos - next);
-
-                if (diff == gf::Vector2i(1, 0) || diff == gf::Vector2i(0, 1)) {
-                  finalColor += 24.0f * nextColor;
-                  finalCoeff += 24.0f;
-                } else if (diff == gf::Vector2i(1, 1)) {
-                  finalColor += 16.0f * nextColor;
-                  finalCoeff += 16.0f;
-                } else if (diff == gf::Vector2i(2, 0) || diff == gf::Vector2i(0, 2)) {
-                  finalColor += 6.0f * nextColor;
-                  finalCoeff += 6.0f;
-                } else if (diff == gf::Vector2i(2, 1) || diff == gf::Vector2i(1, 2)) {
-                  finalColor += 4.0f * nextColor;
-                  finalCoeff += 4.0f;
-                } else if (diff == gf::Vector2i(2, 2)) {
-                  finalColor += 1.0f * nextColor;
-                  finalCoeff += 1.0f;
-                } else {
-                  assert(false);
-                }
+              if (minDistance < SharpenDistance) {
+                color = gf::Color::darker(color, (SharpenDistance - minDistance) * 0.05);
+                color.a = gf::lerp(color.a, 1.0f, (SharpenDistance - minDistance) / 5.0f);
               }
 
-              color = finalColor / finalCoeff;
-            }
+              break;
 
-            break;
+            case BorderEffect::Blur:
+              if (minDistance < BlurDistance) {
+                color = blurred(colorPos);
+              }
 
-          case BorderEffect::None:
-            break;
-        }
+              break;
+
+            case BorderEffect::None:
+              break;
+          }
 
-        newColors(colorPos) = color;
+          newColors(colorPos) = color;
+          ++borderPixels;
+        }
       }
 
     }
 
+    if (!inPlace) {
+      colors.swap(newColors);
+    }
 
-    colors = std::move(newColors);
+    Profiler::get().count(Counter::BorderPixels, borderPixels);
   }
 
-  void Tile::fillColorsBorder() {
-    if (spacing == 0) {
-      return;
-    }
+  /*
+   * The effects read the colors from before any effect. They can be written
+   * in place if no pixel is written twice (a biome on a side of both borders)
+   * and if no side is blurred (the blur reads the other pixels).
+   */
+  bool Tile::canGenerateBorderInPlace() const {
+    PaletteIndex empty = palette.find(Void);
+    PaletteIndex written[4];
+    int count = 0;
 
-    auto dims = colors.getSize();
+    for (int i = 0; i < borders.count; ++i) {
+      auto& border = borders.border[i];
 
-    assert(dims.width = size + 2 * spacing);
-    assert(dims.height = size + 2 * spacing);
+      if (border.effect == BorderEffect::None) {
+        continue;
+      }
 
-    for (int i = 0; i < size; ++i) {
-      for (int j = 0; j < spacing; ++j) {
-        // top
-        colors({ i + spacing, j }) = colors({ i + spacing, spacing });
-        // bottom
-        colors({ i + spacing, dims.height - j - 1 }) = colors({ i + spacing, dims.height - spacing - 1 });
+      if (border.effect == BorderEffect::Blur) {
+        return false;
       }
-    }
 
-    for (int i = 0; i < size + 2 * spacing; ++i) {
-      for (int j = 0; j < spacing; ++j) {
-        // left
-        colors({ j, i }) = colors({ spacing, i });
-        // right
-        colors({ dims.width - j - 1, i }) = colors({ dims.width - spacing - 1, i });
+      for (auto id : { border.b1, border.b2 }) {
+        PaletteIndex index = palette.find(id);
+
+        if (index == empty || index == InvalidIndex) {
+          continue;
+        }
+
+        if (std::find(written, written + count, index) != written + count) {
+          return false;
+        }
+
+        assert(count < 4);
+        written[count++] = index;
       }
     }
+
+    return true;
   }
 
 }
@@ -1,18 +1,36 @@
 #ifndef TLGN_TILE_H
 #define TLGN_TILE_H
 
+#include <cstdint>
+
 #include <gf/Array2D.h>
 #include <gf/Direction.h>
 #include <gf/Id.h>
+#include <gf/Random.h>
 #include <gf/Vector.h>
 
 #include "Settings.h"
 #include "Biomes.h"
+#include "Database.h"
 
 namespace tlgn {
 
-  using Pixels = gf::Array2D<gf::Id, int>;
+  using PaletteIndex = uint8_t;
+  constexpr PaletteIndex InvalidIndex = 0xFF;
+
+  using Pixels = gf::Array2D<PaletteIndex, int>;
   using Colors = gf::Array2D<gf::Color4f, int>;
+  // colors quantized to 8 bits per channel, like the final image
+  using Texels = gf::Array2D<gf::Color4u, int>;
+
+  // the biomes of a tile: at most three biomes plus Void
+  struct Palette {
+    int count = 0;
+    gf::Id biome[4];
+
+    PaletteIndex add(gf::Id id);
+    PaletteIndex find(gf::Id id) const;
+  };
 
 
   struct Fence {
@@ -35,6 +53,11 @@ namespace tlgn {
   constexpr std::size_t TerrainBottomLeft = 2;
   constexpr std::size_t TerrainBottomRight = 3;
 
+  // position in a canonical square of the given extent, of the position pos once the square is turned by some quarters
+  gf::Vector2i computeCanonicalPosition(gf::Vector2i pos, int extent, int quarters);
+  // step in the canonical square when the position moves right once the square is turned by some quarters
+  gf::Vector2i computeCanonicalStep(int quarters);
+
   struct Tile {
     Tile(const TileSettings& settings, gf::Id biome = gf::InvalidId);
     Tile(gf::NoneType);
@@ -42,23 +65,29 @@ namespace tlgn {
     int size;
     int spacing;
 
+    Palette palette;
     Pixels pixels;
-    Colors colors;
+    Colors colors; // only during colorize
+    Texels texels;
 
     std::array<gf::Id, 4> terrain;
     Fences fences;
     Borders borders;
 
-    int id;
+    int id; // in its page
+    int page;
+
+    // the pixels and texels stay in the canonical orientation, the quarter
+    // turns are applied when the tile is written in the image
+    int orientation;
 
     void rotate(int quarters);
-    void colorize(const std::map<gf::Id, Biome>& biomes, gf::Random& random);
+    void colorize(const Database& db, gf::Random& random);
 
   private:
-    void checkPixels();
-    void generateColors(const std::map<gf::Id, Biome>& biomes, gf::Random& random);
+    void checkPixelRow(int row);
     void generateBorder();
-    void fillColorsBorder();
+    bool canGenerateBorderInPlace() const;
   };
 
 } // namespace tlgn
@@ -0,0 +1,101 @@
+#include "TileProvider.h"
+
+#include <cassert>
+#include <iostream>
+#include <utility>
+
+#include "Export.h"
+#include "Seed.h"
+#include "Tileset.h"
+
+namespace tlgn {
+
+  TileProvider::TileProvider(Database db, uint64_t seed, std::size_t capacity)
+  : m_db(std::move(db))
+  , m_seed(seed)
+  , m_capacity(capacity)
+  , m_hits(0)
+  , m_misses(0)
+  {
+    assert(m_capacity > 0);
+    m_db.compile(); // the database may have been built in code
+  }
+
+  std::shared_ptr<const TileImage> TileProvider::getTile(const std::array<gf::Id, 4>& terrain, uint64_t variant) {
+    Key key = { terrain, variant };
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_index.find(key);
+
+      if (it != m_index.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        ++m_hits;
+        return it->second->second;
+      }
+
+      ++m_misses;
+    }
+
+    // generated outside of the lock, another thread may generate the same tile
+    auto image = generate(key);
+
+    if (!image) {
+      return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_index.find(key) == m_index.end()) {
+      m_entries.emplace_front(key, image);
+      m_index.insert({ key, m_entries.begin() });
+
+      if (m_entries.size() > m_capacity) {
+        m_index.erase(m_entries.back().first);
+        m_entries.pop_back();
+      }
+    }
+
+    return image;
+  }
+
+  TileProviderStats TileProvider::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return { m_hits, m_misses };
+  }
+
+  std::size_t TileProvider::KeyHash::operator()(const Key& key) const {
+    uint64_t hash = key.variant;
+
+    for (auto biome : key.terrain) {
+      hash = (hash ^ biome) * UINT64_C(0x100000001b3);
+    }
+
+    return static_cast<std::size_t>(hash ^ (hash >> 32));
+  }
+
+  std::shared_ptr<const TileImage> TileProvider::generate(const Key& key) const {
+    for (auto biome : key.terrain) {
+      if (m_db.getCompiled().intern(biome) == CompiledDatabase::InvalidBiome) {
+        std::cerr << "Unknown biome id: " << biome << '\n';
+        return nullptr;
+      }
+    }
+
+    Tile tile(gf::None);
+
+    if (!generateTile(key.terrain, getTerrainRandom(m_seed, key.terrain, key.variant, SeedPurpose::Geometry), m_db, tile)) {
+      return nullptr;
+    }
+
+    gf::Random random = getTerrainRandom(m_seed, key.terrain, key.variant, SeedPurpose::Colors);
+    tile.colorize(m_db, random);
+
+    auto image = std::make_shared<TileImage>();
+    image->texels = Texels(tile.texels.getSize());
+    renderTile(tile, image->texels);
+    image->fences = tile.fences;
+    return image;
+  }
+
+}
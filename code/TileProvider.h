@@ -0,0 +1,77 @@
+#ifndef TILEGEN_TILE_PROVIDER_H
+#define TILEGEN_TILE_PROVIDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <gf/Id.h>
+
+#include "Database.h"
+#include "Tile.h"
+
+namespace tlgn {
+
+  // a tile ready to be drawn
+  struct TileImage {
+    Texels texels; // in the final orientation, with the spacing
+    Fences fences;
+  };
+
+  struct TileProviderStats {
+    std::size_t hits;
+    std::size_t misses;
+  };
+
+  /*
+   * Tiles generated one at a time from their corners, for the transitions
+   * that are not in an atlas. The same corners and variant always give the
+   * same tile. The recently used tiles are kept in a bounded LRU cache. The
+   * provider can be used from several threads.
+   */
+  class TileProvider {
+  public:
+    TileProvider(Database db, uint64_t seed, std::size_t capacity);
+
+    // the corners are like Tile::terrain; nullptr if there is no such tile (four different biomes, unknown biome)
+    std::shared_ptr<const TileImage> getTile(const std::array<gf::Id, 4>& terrain, uint64_t variant);
+
+    TileProviderStats getStats() const;
+
+  private:
+    struct Key {
+      std::array<gf::Id, 4> terrain;
+      uint64_t variant;
+
+      bool operator==(const Key& other) const {
+        return terrain == other.terrain && variant == other.variant;
+      }
+    };
+
+    struct KeyHash {
+      std::size_t operator()(const Key& key) const;
+    };
+
+    using Entry = std::pair<Key, std::shared_ptr<const TileImage>>;
+
+    std::shared_ptr<const TileImage> generate(const Key& key) const;
+
+  private:
+    Database m_db;
+    uint64_t m_seed;
+    std::size_t m_capacity;
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_entries; // the most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_index;
+    std::size_t m_hits;
+    std::size_t m_misses;
+  };
+
+}
+
+#endif // TILEGEN_TILE_PROVIDER_H
@@ -1,12 +1,14 @@
 #include "Tileset.h"
 
-#include <queue>
+#include <cassert>
+#include <algorithm>
 
-#include <gf/ArrayRef.h>
-#include <gf/Geometry.h>
 #include <gf/Unused.h>
 #include <gf/VectorOps.h>
 
+#include "Fill.h"
+#include "Line.h"
+
 namespace tlgn {
 
   namespace {
@@ -46,70 +48,6 @@ namespace tlgn {
       return { settings.size - 1, settings.size - 1 };
     }
 
-
-    void fillBiomeFrom(Pixels& pixels, gf::Vector2i pos, gf::Id biome) {
-      pixels(pos) = biome;
-
-      std::queue<gf::Vector2i> q;
-      q.push(pos);
-
-      while (!q.empty()) {
-        auto curr = q.front();
-
-        assert(pixels(curr) == biome);
-
-        for (auto next : pixels.get4NeighborsRange(curr)) {
-          gf::Id nextBiome = pixels(next);
-
-          if (nextBiome == gf::InvalidId) {
-            pixels(next) = biome;
-            q.push(next);
-          }
-        }
-
-        q.pop();
-      }
-
-    }
-
-
-    std::vector<gf::Vector2i> makeLine(const TileSettings& settings, gf::ArrayRef<gf::Vector2i> points, gf::Random& random) {
-      constexpr unsigned GenerationIterations = 2;
-      constexpr float InitialFactor = 0.5f;
-      constexpr float ReductionFactor = 0.6f;
-
-      // generate random line points
-
-      std::vector<gf::Vector2i> tmp;
-
-      for (std::size_t i = 0; i < points.getSize() - 1; ++i) {
-        auto line = gf::midpointDisplacement1D(points[i], points[i + 1], random, GenerationIterations, InitialFactor, ReductionFactor);
-        tmp.insert(tmp.end(), line.begin(), line.end());
-        tmp.pop_back();
-      }
-
-      tmp.push_back(points[points.getSize() - 1]);
-
-      // normalize
-
-      for (auto& point : tmp) {
-        point = gf::clamp(point, 0, settings.size - 1);
-      }
-
-      // compute final line
-
-      std::vector<gf::Vector2i> out;
-
-      for (std::size_t i = 0; i < tmp.size() - 1; ++i) {
-        auto line = gf::generateLine(tmp[i], tmp[i + 1]);
-        out.insert(out.end(), line.begin(), line.end());
-      }
-
-      out.push_back(points[points.getSize() - 1]);
-
-      return out;
-    }
-
     /*
      * Two Corner Wang Tileset generators
      */
@@ -126,8 +64,10 @@ namespace tlgn {
     };
 
     // b1 is in the left|top, b2 is in the right|bottom
-    Tile generateSplit(const TileSettings& settings, gf::Id b1, gf::Id b2, Split s, gf::Random& random, const Frontier& frontier) {
+    Tile generateSplit(const TileSettings& settings, gf::Id b1, gf::Id b2, Split s, gf::Random random, const Frontier& frontier) {
       Tile tile(settings);
+      PaletteIndex i1 = tile.palette.add(b1);
+      PaletteIndex i2 = tile.palette.add(b2);
 
       gf::Vector2i endPoints[2];
       int half = settings.size / 2;
@@ -143,14 +83,10 @@ namespace tlgn {
           break;
       }
 
-      auto line = makeLine(settings, endPoints, random);
-
-      for (auto point : line) {
-        tile.pixels(point) = b2;
-      }
+      drawLine(tile.pixels, settings, endPoints, random, i2);
 
-      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), b1);
-      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), b2);
+      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), i1);
+      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), i2);
 
       switch (s) {
         case Split::Horizontal:
@@ -195,8 +131,10 @@ namespace tlgn {
     };
 
     // b1 is in the corner, b2 is in the rest
-    Tile generateCorner(const TileSettings& settings, gf::Id b1, gf::Id b2, Corner c, gf::Random& random, const Frontier& frontier) {
+    Tile generateCorner(const TileSettings& settings, gf::Id b1, gf::Id b2, Corner c, gf::Random random, const Frontier& frontier) {
       Tile tile(settings);
+      PaletteIndex i1 = tile.palette.add(b1);
+      PaletteIndex i2 = tile.palette.add(b2);
 
       gf::Vector2i endPoints[2];
       int half = settings.size / 2;
@@ -220,28 +158,24 @@ namespace tlgn {
           break;
       }
 
-      auto line = makeLine(settings, endPoints, random);
-
-      for (auto point : line) {
-        tile.pixels(point) = b1;
-      }
+      drawLine(tile.pixels, settings, endPoints, random, i1);
 
       switch (c) {
         case Corner::TopLeft:
-          fillBiomeFrom(tile.pixels, cornerTopLeft(settings), b1);
-          fillBiomeFrom(tile.pixels, cornerBottomRight(settings), b2);
+          fillBiomeFrom(tile.pixels, cornerTopLeft(settings), i1);
+          fillBiomeFrom(tile.pixels, cornerBottomRight(settings), i2);
           break;
         case Corner::TopRight:
-          fillBiomeFrom(tile.pixels, cornerTopRight(settings), b1);
-          fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), b2);
+          fillBiomeFrom(tile.pixels, cornerTopRight(settings), i1);
+          fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), i2);
           break;
         case Corner::BottomLeft:
-          fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), b1);
-          fillBiomeFrom(tile.pixels, cornerTopRight(settings), b2);
+          fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), i1);
+          fillBiomeFrom(tile.pixels, cornerTopRight(settings), i2);
           break;
         case Corner::BottomRight:
-          fillBiomeFrom(tile.pixels, cornerBottomRight(settings), b1);
-          fillBiomeFrom(tile.pixels, cornerTopLeft(settings), b2);
+          fillBiomeFrom(tile.pixels, cornerBottomRight(settings), i1);
+          fillBiomeFrom(tile.pixels, cornerTopLeft(settings), i2);
           break;
       }
 
@@ -293,30 +227,25 @@ namespace tlgn {
     }
 
     // b1 is in top-left and bottom-right, b2 is in top-right and bottom-left
-    Tile generateCross(const TileSettings& settings, gf::Id b1, gf::Id b2, gf::Random& random, const Frontier& frontier) {
+    Tile generateCross(const TileSettings& settings, gf::Id b1, gf::Id b2, gf::Random random, const Frontier& frontier) {
       Tile tile(settings);
+      PaletteIndex i1 = tile.palette.add(b1);
+      PaletteIndex i2 = tile.palette.add(b2);
+
       int half = settings.size / 2;
 
       gf::Vector2i limitTopRight[] = { top(settings, half + frontier.offset), { half, half - 1 }, right(settings, half - 1 - frontier.offset) };
 
-      auto lineTopRight = makeLine(settings, limitTopRight, random);
-
-      for (auto point : lineTopRight) {
-        tile.pixels(point) = b2;
-      }
+      drawLine(tile.pixels, settings, limitTopRight, random, i2);
 
       gf::Vector2i limitBottomLeft[] = { bottom(settings, half - 1 - frontier.offset), { half - 1, half }, left(settings, half + frontier.offset) };
 
-      auto lineBottomLeft = makeLine(settings, limitBottomLeft, random);
-
-      for (auto point : lineBottomLeft) {
-        tile.pixels(point) = b2;
-      }
+      drawLine(tile.pixels, settings, limitBottomLeft, random, i2);
 
-      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), b1);
-      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), b1);
-      fillBiomeFrom(tile.pixels, cornerTopRight(settings), b2);
-      fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), b2);
+      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), i1);
+      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), i1);
+      fillBiomeFrom(tile.pixels, cornerTopRight(settings), i2);
+      fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), i2);
 
       tile.terrain[TerrainTopLeft] = tile.terrain[TerrainBottomRight] = b1;
       tile.terrain[TerrainTopRight] = tile.terrain[TerrainBottomLeft] = b2;
@@ -341,29 +270,25 @@ namespace tlgn {
      */
 
     // b1 is top, b2 is in bottom-left, b3 is in bottom-right
-    Tile generate211(const TileSettings& settings, gf::Id b1, gf::Id b2, gf::Id b3, gf::Random& random, const Frontier& frontier12, const Frontier& frontier23, const Frontier& frontier31) {
+    Tile generate211(const TileSettings& settings, gf::Id b1, gf::Id b2, gf::Id b3, gf::Random random, const Frontier& frontier12, const Frontier& frontier23, const Frontier& frontier31) {
       Tile tile(settings);
+      PaletteIndex i1 = tile.palette.add(b1);
+      PaletteIndex i2 = tile.palette.add(b2);
+      PaletteIndex i3 = tile.palette.add(b3);
+
       int half = settings.size / 2;
 
       gf::Vector2i limitBottomLeft[] = { left(settings, half + frontier12.offset), /* { half - 1, half }, */ bottom(settings, half - 1 + frontier23.offset) };
 
-      auto lineBottomLeft = makeLine(settings, limitBottomLeft, random);
-
-      for (auto point : lineBottomLeft) {
-        tile.pixels(point) = b2;
-      }
+      drawLine(tile.pixels, settings, limitBottomLeft, random, i2);
 
       gf::Vector2i limitBottomRight[] = { right(settings, half - frontier31.offset), /* { half, half }, */ bottom(settings, half + frontier23.offset) };
 
-      auto lineBottomRight = makeLine(settings, limitBottomRight, random);
-
-      for (auto point : lineBottomRight) {
-        tile.pixels(point) = b3;
-      }
+      drawLine(tile.pixels, settings, limitBottomRight, random, i3);
 
-      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), b1);
-      fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), b2);
-      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), b3);
+      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), i1);
+      fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), i2);
+      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), i3);
 
       tile.terrain[TerrainTopLeft] = tile.terrain[TerrainTopRight] = b1;
       tile.terrain[TerrainBottomLeft] = b2;
@@ -393,30 +318,26 @@ namespace tlgn {
       return tile;
     }
 
-    Tile generate211Cross(const TileSettings& settings, gf::Id b1, gf::Id b2, gf::Id b3, gf::Random& random, const Frontier& frontier12, const Frontier& frontier31) {
+    Tile generate211Cross(const TileSettings& settings, gf::Id b1, gf::Id b2, gf::Id b3, gf::Random random, const Frontier& frontier12, const Frontier& frontier31) {
       Tile tile(settings);
+      PaletteIndex i1 = tile.palette.add(b1);
+      PaletteIndex i2 = tile.palette.add(b2);
+      PaletteIndex i3 = tile.palette.add(b3);
+
       int half = settings.size / 2;
 
       gf::Vector2i limitTopRight[] = { right(settings, half - 1 - frontier12.offset), top(settings, half + frontier12.offset) };
 
-      auto lineTopRight = makeLine(settings, limitTopRight, random);
-
-      for (auto point : lineTopRight) {
-        tile.pixels(point) = b2;
-      }
+      drawLine(tile.pixels, settings, limitTopRight, random, i2);
 
       gf::Vector2i limitBottomLeft[] = { left(settings, half - frontier31.offset), bottom(settings, half - 1 + frontier31.offset) };
 
-      auto lineBottomLeft = makeLine(settings, limitBottomLeft, random);
-
-      for (auto point : lineBottomLeft) {
-        tile.pixels(point) = b3;
-      }
+      drawLine(tile.pixels, settings, limitBottomLeft, random, i3);
 
-      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), b1);
-      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), b1);
-      fillBiomeFrom(tile.pixels, cornerTopRight(settings), b2);
-      fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), b3);
+      fillBiomeFrom(tile.pixels, cornerTopLeft(settings), i1);
+      fillBiomeFrom(tile.pixels, cornerBottomRight(settings), i1);
+      fillBiomeFrom(tile.pixels, cornerTopRight(settings), i2);
+      fillBiomeFrom(tile.pixels, cornerBottomLeft(settings), i3);
 
       tile.terrain[TerrainTopLeft] = tile.terrain[TerrainBottomRight] = b1;
       tile.terrain[TerrainTopRight] = b2;
@@ -446,6 +367,82 @@ namespace tlgn {
       return tile;
     }
 
+    /*
+     * Single tiles
+     */
+
+    // the corners once the tile is turned, like Tile::rotate
+    std::array<gf::Id, 4> rotateTerrain(std::array<gf::Id, 4> terrain, int quarters) {
+      for (int q = 0; q < quarters; ++q) {
+        auto tmp = terrain[TerrainTopLeft];
+        terrain[TerrainTopLeft] = terrain[TerrainTopRight];
+        terrain[TerrainTopRight] = terrain[TerrainBottomRight];
+        terrain[TerrainBottomRight] = terrain[TerrainBottomLeft];
+        terrain[TerrainBottomLeft] = tmp;
+      }
+
+      return terrain;
+    }
+
+    Tile generateTwoBiomesTile(const std::array<gf::Id, 4>& t, gf::Random random, const Database& db) {
+      const TileSettings& settings = db.settings.tile;
+
+      if (t[TerrainTopLeft] == t[TerrainBottomRight] && t[TerrainTopRight] == t[TerrainBottomLeft]) {
+        return generateCross(settings, t[TerrainTopLeft], t[TerrainTopRight], random, db.getFrontier(t[TerrainTopLeft], t[TerrainTopRight]));
+      }
+
+      if (t[TerrainTopLeft] == t[TerrainTopRight] && t[TerrainBottomLeft] == t[TerrainBottomRight]) {
+        return generateSplit(settings, t[TerrainTopLeft], t[TerrainBottomLeft], Split::Horizontal, random, db.getFrontier(t[TerrainTopLeft], t[TerrainBottomLeft]));
+      }
+
+      if (t[TerrainTopLeft] == t[TerrainBottomLeft] && t[TerrainTopRight] == t[TerrainBottomRight]) {
+        return generateSplit(settings, t[TerrainTopLeft], t[TerrainTopRight], Split::Vertical, random, db.getFrontier(t[TerrainTopLeft], t[TerrainTopRight]));
+      }
+
+      // one corner is different from the three others
+      static constexpr std::size_t Corners[] = { TerrainTopLeft, TerrainTopRight, TerrainBottomLeft, TerrainBottomRight };
+      static constexpr Corner CornerValues[] = { Corner::TopLeft, Corner::TopRight, Corner::BottomLeft, Corner::BottomRight };
+
+      for (std::size_t i = 0; i < 4; ++i) {
+        gf::Id corner = t[Corners[i]];
+        gf::Id rest = t[Corners[(i + 1) % 4]];
+
+        if (std::count(t.begin(), t.end(), corner) == 1) {
+          return generateCorner(settings, corner, rest, CornerValues[i], random, db.getFrontier(corner, rest));
+        }
+      }
+
+      assert(false);
+      return Tile(gf::None);
+    }
+
+    bool generateThreeBiomesTile(const std::array<gf::Id, 4>& terrain, gf::Random random, const Database& db, Tile& tile) {
+      const TileSettings& settings = db.settings.tile;
+
+      // the canonical tile is found by turning the corners back
+      for (int q = 0; q < 4; ++q) {
+        auto t = rotateTerrain(terrain, (4 - q) & 3);
+
+        // b1 is top, b2 is in bottom-left, b3 is in bottom-right
+        if (t[TerrainTopLeft] == t[TerrainTopRight]) {
+          gf::Id b1 = t[TerrainTopLeft], b2 = t[TerrainBottomLeft], b3 = t[TerrainBottomRight];
+          tile = generate211(settings, b1, b2, b3, random, db.getFrontier(b1, b2), db.getFrontier(b2, b3), db.getFrontier(b3, b1));
+          tile.rotate(q);
+          return true;
+        }
+
+        // b1 is in top-left and bottom-right, b2 is in top-right, b3 is in bottom-left
+        if (t[TerrainTopLeft] == t[TerrainBottomRight] && q < 2) {
+          gf::Id b1 = t[TerrainTopLeft], b2 = t[TerrainTopRight], b3 = t[TerrainBottomLeft];
+          tile = generate211Cross(settings, b1, b2, b3, random, db.getFrontier(b1, b2), db.getFrontier(b3, b1));
+          tile.rotate(q);
+          return true;
+        }
+      }
+
+      return false;
+    }
+
   }
 
 
@@ -468,30 +465,34 @@ namespace tlgn {
    *    b1 = ' '
    *    b2 = '#'
    */
-  Tileset generateTwoCornersWangTileset(gf::Id b1, gf::Id b2, gf::Random& random, const Database& db) {
-    Tileset tileset({ 4, 4 }, gf::None);
+  Tileset generateTwoCornersWangTileset(gf::Id b1, gf::Id b2, const TilesetSeed& seed, const Database& db) {
+    Tileset tileset(getTilesetSize(SeedCategory::TwoCorners), gf::None);
 
     auto frontier = db.getFrontier(b1, b2);
 
-    tileset({ 0, 0 }) = generateCorner(db.settings.tile, b2, b1, Corner::BottomLeft, random, frontier.inverse());
-    tileset({ 0, 1 }) = generateCross(db.settings.tile, b2, b1, random, frontier.inverse());
-    tileset({ 0, 2 }) = generateCorner(db.settings.tile, b2, b1, Corner::TopRight, random, frontier.inverse());
+    auto random = [&seed](gf::Vector2i position) {
+      return seed.getTileRandom(position, SeedPurpose::Geometry);
+    };
+
+    tileset({ 0, 0 }) = generateCorner(db.settings.tile, b2, b1, Corner::BottomLeft, random({ 0, 0 }), frontier.inverse());
+    tileset({ 0, 1 }) = generateCross(db.settings.tile, b2, b1, random({ 0, 1 }), frontier.inverse());
+    tileset({ 0, 2 }) = generateCorner(db.settings.tile, b2, b1, Corner::TopRight, random({ 0, 2 }), frontier.inverse());
     tileset({ 0, 3 }) = generateFull(db.settings.tile, b1);
 
-    tileset({ 1, 0 }) = generateSplit(db.settings.tile, b1, b2, Split::Vertical, random, frontier);
-    tileset({ 1, 1 }) = generateCorner(db.settings.tile, b1, b2, Corner::TopLeft, random, frontier);
-    tileset({ 1, 2 }) = generateSplit(db.settings.tile, b2, b1, Split::Horizontal, random, frontier.inverse());
-    tileset({ 1, 3 }) = generateCorner(db.settings.tile, b2, b1, Corner::BottomRight, random, frontier.inverse());
+    tileset({ 1, 0 }) = generateSplit(db.settings.tile, b1, b2, Split::Vertical, random({ 1, 0 }), frontier);
+    tileset({ 1, 1 }) = generateCorner(db.settings.tile, b1, b2, Corner::TopLeft, random({ 1, 1 }), frontier);
+    tileset({ 1, 2 }) = generateSplit(db.settings.tile, b2, b1, Split::Horizontal, random({ 1, 2 }), frontier.inverse());
+    tileset({ 1, 3 }) = generateCorner(db.settings.tile, b2, b1, Corner::BottomRight, random({ 1, 3 }), frontier.inverse());
 
-    tileset({ 2, 0 }) = generateCorner(db.settings.tile, b1, b2, Corner::TopRight, random, frontier);
+    tileset({ 2, 0 }) = generateCorner(db.settings.tile, b1, b2, Corner::TopRight, random({ 2, 0 }), frontier);
     tileset({ 2, 1 }) = generateFull(db.settings.tile, b2);
-    tileset({ 2, 2 }) = generateCorner(db.settings.tile, b1, b2, Corner::BottomLeft, random, frontier);
-    tileset({ 2, 3 }) = generateCross(db.settings.tile, b1, b2, random, frontier);
+    tileset({ 2, 2 }) = generateCorner(db.settings.tile, b1, b2, Corner::BottomLeft, random({ 2, 2 }), frontier);
+    tileset({ 2, 3 }) = generateCross(db.settings.tile, b1, b2, random({ 2, 3 }), frontier);
 
-    tileset({ 3, 0 }) = generateSplit(db.settings.tile, b1, b2, Split::Horizontal, random, frontier);
-    tileset({ 3, 1 }) = generateCorner(db.settings.tile, b1, b2, Corner::BottomRight, random, frontier);
-    tileset({ 3, 2 }) = generateSplit(db.settings.tile, b2, b1, Split::Vertical, random, frontier.inverse());
-    tileset({ 3, 3 }) = generateCorner(db.settings.tile, b2, b1, Corner::TopLeft, random, frontier.inverse());
+    tileset({ 3, 0 }) = generateSplit(db.settings.tile, b1, b2, Split::Horizontal, random({ 3, 0 }), frontier);
+    tileset({ 3, 1 }) = generateCorner(db.settings.tile, b1, b2, Corner::BottomRight, random({ 3, 1 }), frontier);
+    tileset({ 3, 2 }) = generateSplit(db.settings.tile, b2, b1, Split::Vertical, random({ 3, 2 }), frontier.inverse());
+    tileset({ 3, 3 }) = generateCorner(db.settings.tile, b2, b1, Corner::TopLeft, random({ 3, 3 }), frontier.inverse());
 
     return tileset;
   }
@@ -517,55 +518,59 @@ namespace tlgn {
   +----+
 
   */
-  Tileset generateThreeCornersWangTileset(gf::Id b1, gf::Id b2, gf::Id b3, gf::Random& random, const Database& db) {
-    Tileset tileset({ 9, 4 }, gf::None);
+  Tileset generateThreeCornersWangTileset(gf::Id b1, gf::Id b2, gf::Id b3, const TilesetSeed& seed, const Database& db) {
+    Tileset tileset(getTilesetSize(SeedCategory::ThreeCorners), gf::None);
 
     auto frontier12 = db.getFrontier(b1, b2);
     auto frontier23 = db.getFrontier(b2, b3);
     auto frontier31 = db.getFrontier(b3, b1);
 
+    auto random = [&seed](gf::Vector2i position) {
+      return seed.getTileRandom(position, SeedPurpose::Geometry);
+    };
+
     for (int q = 0; q < 4; ++q) {
-      tileset({ 0, q }) = generate211(db.settings.tile, b1, b2, b3, random, frontier12, frontier23, frontier31);
+      tileset({ 0, q }) = generate211(db.settings.tile, b1, b2, b3, random({ 0, q }), frontier12, frontier23, frontier31);
       tileset({ 0, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 1, q }) = generate211(db.settings.tile, b2, b3, b1, random, frontier23, frontier31, frontier12);
+      tileset({ 1, q }) = generate211(db.settings.tile, b2, b3, b1, random({ 1, q }), frontier23, frontier31, frontier12);
       tileset({ 1, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 2, q }) = generate211(db.settings.tile, b3, b1, b2, random, frontier31, frontier12, frontier23);
+      tileset({ 2, q }) = generate211(db.settings.tile, b3, b1, b2, random({ 2, q }), frontier31, frontier12, frontier23);
       tileset({ 2, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 3, q }) = generate211(db.settings.tile, b1, b3, b2, random, frontier31.inverse(), frontier23.inverse(), frontier12.inverse());
+      tileset({ 3, q }) = generate211(db.settings.tile, b1, b3, b2, random({ 3, q }), frontier31.inverse(), frontier23.inverse(), frontier12.inverse());
       tileset({ 3, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 4, q }) = generate211(db.settings.tile, b3, b2, b1, random, frontier23.inverse(), frontier12.inverse(), frontier31.inverse());
+      tileset({ 4, q }) = generate211(db.settings.tile, b3, b2, b1, random({ 4, q }), frontier23.inverse(), frontier12.inverse(), frontier31.inverse());
       tileset({ 4, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 5, q }) = generate211(db.settings.tile, b2, b1, b3, random, frontier12.inverse(), frontier31.inverse(), frontier23.inverse());
+      tileset({ 5, q }) = generate211(db.settings.tile, b2, b1, b3, random({ 5, q }), frontier12.inverse(), frontier31.inverse(), frontier23.inverse());
       tileset({ 5, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 6, q }) = generate211Cross(db.settings.tile, b1, b2, b3, random, frontier12, frontier31);
+      tileset({ 6, q }) = generate211Cross(db.settings.tile, b1, b2, b3, random({ 6, q }), frontier12, frontier31);
       tileset({ 6, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 7, q }) = generate211Cross(db.settings.tile, b2, b3, b1, random, frontier23, frontier12);
+      tileset({ 7, q }) = generate211Cross(db.settings.tile, b2, b3, b1, random({ 7, q }), frontier23, frontier12);
       tileset({ 7, q }).rotate(q);
     }
 
     for (int q = 0; q < 4; ++q) {
-      tileset({ 8, q }) = generate211Cross(db.settings.tile, b3, b1, b2, random, frontier31, frontier23);
+      tileset({ 8, q }) = generate211Cross(db.settings.tile, b3, b1, b2, random({ 8, q }), frontier31, frontier23);
       tileset({ 8, q }).rotate(q);
     }
 
@@ -574,7 +579,7 @@ namespace tlgn {
 
 
   Tileset generatePlainTileset(gf::Id b0, const Database& db) {
-    Tileset tileset({ 4, 4 }, gf::None);
+    Tileset tileset(getTilesetSize(SeedCategory::Plain), gf::None);
 
     for (int i = 0; i < 4; ++i) {
       for (int j = 0; j < 4; ++j) {
@@ -585,6 +590,28 @@ namespace tlgn {
     return tileset;
   }
 
-}
+  bool generateTile(const std::array<gf::Id, 4>& terrain, gf::Random random, const Database& db, Tile& tile) {
+    std::array<gf::Id, 4> biomes = terrain;
+    std::sort(biomes.begin(), biomes.end());
+    auto count = std::unique(biomes.begin(), biomes.end()) - biomes.begin();
+
+    switch (count) {
+      case 1:
+        tile = generateFull(db.settings.tile, terrain[0]);
+        return true;
+
+      case 2:
+        tile = generateTwoBiomesTile(terrain, random, db);
+        return true;
 
+      case 3:
+        return generateThreeBiomesTile(terrain, random, db, tile);
 
+      default:
+        break;
+    }
+
+    return false;
+  }
+
+}
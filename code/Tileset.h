@@ -1,11 +1,13 @@
 #ifndef TILEGEN_TILESET_H
 #define TILEGEN_TILESET_H
 
+#include <array>
+
 #include <gf/Array2D.h>
 #include <gf/Id.h>
-#include <gf/Random.h>
 
 #include "Database.h"
+#include "Seed.h"
 #include "Tile.h"
 
 namespace tlgn {
@@ -13,8 +15,11 @@ namespace tlgn {
   using Tileset = gf::Array2D<Tile, int>;
 
   Tileset generatePlainTileset(gf::Id b0, const Database& db);
-  Tileset generateTwoCornersWangTileset(gf::Id b1, gf::Id b2, gf::Random& random, const Database& db);
-  Tileset generateThreeCornersWangTileset(gf::Id b1, gf::Id b2, gf::Id b3, gf::Random& random, const Database& db);
+  Tileset generateTwoCornersWangTileset(gf::Id b1, gf::Id b2, const TilesetSeed& seed, const Database& db);
+  Tileset generateThreeCornersWangTileset(gf::Id b1, gf::Id b2, gf::Id b3, const TilesetSeed& seed, const Database& db);
+
+  // the geometry of a single tile with the given corners, at most three different biomes; false if there is no such tile
+  bool generateTile(const std::array<gf::Id, 4>& terrain, gf::Random random, const Database& db, Tile& tile);
 
 }
 
@@ -0,0 +1,170 @@
+#include "Watch.h"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+#include <gf/Unused.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Profile.h"
+
+namespace tlgn {
+
+#ifdef __linux__
+
+  namespace {
+
+    class Inotify {
+    public:
+      Inotify()
+      : m_fd(inotify_init1(IN_CLOEXEC))
+      {
+      }
+
+      ~Inotify() {
+        if (m_fd >= 0) {
+          close(m_fd);
+        }
+      }
+
+      Inotify(const Inotify&) = delete;
+      Inotify& operator=(const Inotify&) = delete;
+
+      bool isValid() const {
+        return m_fd >= 0;
+      }
+
+      bool addWatch(const gf::Path& directory) {
+        // editors often replace the file, so the directory is watched
+        return inotify_add_watch(m_fd, directory.string().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) >= 0;
+      }
+
+      // blocks until the file is changed, returns false on error
+      bool waitFor(const std::string& name) {
+        for (;;) {
+          if (!readEvents(name, -1)) {
+            return false;
+          }
+
+          if (m_changed) {
+            // a save is often made of several events
+            while (readEvents(name, 50) && m_pending) {
+            }
+
+            m_changed = false;
+            return true;
+          }
+        }
+      }
+
+    private:
+      bool readEvents(const std::string& name, int timeout) {
+        m_pending = false;
+
+        pollfd pfd = { m_fd, POLLIN, 0 };
+        int ret = poll(&pfd, 1, timeout);
+
+        if (ret < 0) {
+          return false;
+        }
+
+        if (ret == 0) {
+          return true;
+        }
+
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length = read(m_fd, buffer, sizeof buffer);
+
+        if (length <= 0) {
+          return false;
+        }
+
+        for (char *ptr = buffer; ptr < buffer + length; ) {
+          auto event = reinterpret_cast<const inotify_event *>(ptr);
+
+          if (event->len > 0 && name == event->name) {
+            m_changed = true;
+          }
+
+          ptr += sizeof(inotify_event) + event->len;
+        }
+
+        m_pending = true;
+        return true;
+      }
+
+    private:
+      int m_fd;
+      bool m_changed = false;
+      bool m_pending = false;
+    };
+
+  }
+
+  bool watchDatabase(const gf::Path& filename, Pipeline& pipeline, const std::function<void()>& updated) {
+    Inotify inotify;
+    gf::Path directory = filename.has_parent_path() ? filename.parent_path() : gf::Path(".");
+
+    if (!inotify.isValid() || !inotify.addWatch(directory)) {
+      std::cerr << "Could not watch the directory: " << directory.string() << '\n';
+      return false;
+    }
+
+    std::string name = filename.filename().string();
+
+    std::cout << "Watching " << filename.string() << "..." << std::endl;
+
+    while (inotify.waitFor(name)) {
+      auto start = std::chrono::steady_clock::now();
+
+      Database db;
+
+      try {
+        ProfileScope scope(Phase::Load);
+        db = Database::load(filename);
+      } catch (std::exception& ex) {
+        std::cerr << "Could not load the database: " << ex.what() << '\n';
+        continue;
+      }
+
+      std::size_t count = pipeline.update(std::move(db));
+
+      if (!pipeline.isReady()) {
+        std::cerr << "Could not update the image\n";
+        continue;
+      }
+
+      if (!pipeline.writeChangedFiles()) {
+        std::cerr << "Could not write the image\n";
+        continue;
+      }
+
+      auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+      // the output is often a pipe, it is shown after each update
+      std::cout << "Updated " << count << " tilesets in " << duration.count() << " ms" << std::endl;
+
+      if (updated) {
+        updated();
+      }
+    }
+
+    return false;
+  }
+
+#else
+
+  bool watchDatabase(const gf::Path& filename, Pipeline& pipeline, const std::function<void()>& updated) {
+    gf::unused(filename, pipeline, updated);
+    std::cerr << "The watch mode is not supported on this platform\n";
+    return false;
+  }
+
+#endif
+
+}
@@ -0,0 +1,17 @@
+#ifndef TILEGEN_WATCH_H
+#define TILEGEN_WATCH_H
+
+#include <functional>
+
+#include <gf/Path.h>
+
+#include "Pipeline.h"
+
+namespace tlgn {
+
+  // updates the pipeline and writes the files each time the database file changes, then calls updated; returns on error only
+  bool watchDatabase(const gf::Path& filename, Pipeline& pipeline, const std::function<void()>& updated);
+
+}
+
+#endif // TILEGEN_WATCH_H
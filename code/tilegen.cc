@@ -1,134 +1,142 @@
 #include <cstdlib>
+#include <cstring>
 
+#include <exception>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 #include <gf/Path.h>
 
 #include "Database.h"
-#include "Export.h"
-#include "Tileset.h"
+#include "Generator.h"
+#include "Log.h"
+#include "Pipeline.h"
+#include "Profile.h"
+#include "Scratch.h"
+#include "Watch.h"
 
-int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    std::cout << "Usage: tilegen <file>\n";
-    return EXIT_FAILURE;
-  }
-
-  // load config file
-
-  gf::Path filename(argv[1]);
-  auto db = tlgn::Database::load(filename);
-
-//   for (auto& kv : db.biomes) {
-//     auto& value = kv.second;
-//     std::cout << std::hex;
-//     std::cout << value.id << ": " << value.name << " [ " << value.pigment.color.r << ',' << value.pigment.color.g << ',' << value.pigment.color.b << ',' << value.pigment.color.a << " ]\n";
-//   }
-
-  // generate pixels
-
-  gf::Random random;
+namespace {
 
-  std::cout << "Computing tiles (1/4)...\n";
-
-  std::vector<tlgn::Tileset> plain;
-
-  {
-    std::map<int, gf::Id> biomes;
+  void printUsage() {
+    std::cout << "Usage: tilegen [--jobs <n>] [--seed <n>] [--cache <dir>] [--png-level <0-9>] [--dedupe] [--stream | --watch] [--stats <file>] [--trace <file>] [--verbose] <file>\n";
+  }
 
-    for (auto& pair : db.biomes) {
-      biomes.insert({ pair.second.index, pair.first });
-    }
+}
 
-    for (auto& kv : biomes) {
-      plain.push_back(tlgn::generatePlainTileset(kv.second, db));
+int main(int argc, char *argv[]) {
+  tlgn::GeneratorOptions options;
+  bool watch = false;
+  bool stream = false;
+  std::string statsFile;
+  std::string traceFile;
+  const char *file = nullptr;
+
+  // the conversions throw on an invalid number
+  try {
+    for (int i = 1; i < argc; ++i) {
+      if (std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+        options.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+      } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+        options.seed = std::stoull(argv[++i]);
+      } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+        options.cacheDirectory = argv[++i];
+      } else if (std::strcmp(argv[i], "--png-level") == 0 && i + 1 < argc) {
+        options.pngLevel = std::stoi(argv[++i]);
+
+        if (options.pngLevel < 0 || options.pngLevel > 9) {
+          printUsage();
+          return EXIT_FAILURE;
+        }
+      } else if (std::strcmp(argv[i], "--dedupe") == 0) {
+        options.dedupe = true;
+      } else if (std::strcmp(argv[i], "--watch") == 0) {
+        watch = true;
+      } else if (std::strcmp(argv[i], "--stream") == 0) {
+        stream = true;
+      } else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+        statsFile = argv[++i];
+      } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+        traceFile = argv[++i];
+        tlgn::Profiler::get().enableTrace();
+      } else if (std::strcmp(argv[i], "--verbose") == 0) {
+        tlgn::setVerbosity(tlgn::Verbosity::Debug);
+      } else if (file == nullptr && argv[i][0] != '-') {
+        file = argv[i];
+      } else {
+        printUsage();
+        return EXIT_FAILURE;
+      }
     }
+  } catch (const std::logic_error&) {
+    printUsage();
+    return EXIT_FAILURE;
   }
 
-  std::cout << "Computing tiles (2/4)...\n";
-
-  std::vector<tlgn::Tileset> wang2;
-
-  for (auto& duo : db.duos) {
-    wang2.push_back(tlgn::generateTwoCornersWangTileset(duo.b1, duo.b2, random, db));
+  // the watch mode updates the image in place and the deduplication needs all the tiles, they need the whole image
+  if (file == nullptr || (stream && (watch || options.dedupe))) {
+    printUsage();
+    return EXIT_FAILURE;
   }
 
-  std::cout << "Computing tiles (3/4)...\n";
+  tlgn::Generator generator(options);
 
-  std::vector<tlgn::Tileset> wang3;
-
-  for (auto& trio : db.trios) {
-    wang3.push_back(tlgn::generateThreeCornersWangTileset(trio.b1, trio.b2, trio.b3, random, db));
-  }
+  // load config file
 
-  std::cout << "Computing tiles (4/4)...\n";
+  gf::Path filename(file);
+  tlgn::Database db;
 
-  std::vector<tlgn::Tileset> overlays;
+  try {
+    tlgn::ProfileScope scope(tlgn::Phase::Load);
+    db = tlgn::Database::load(filename);
+  } catch (std::exception& ex) {
+    std::cerr << "Could not load the database: " << ex.what() << '\n';
+    return EXIT_FAILURE;
+  }
 
-  for (auto& overlay : db.overlays) {
-    overlays.push_back(tlgn::generateTwoCornersWangTileset(overlay.b0, tlgn::Void, random, db));
+  // the pages of an atlas are packed together, they are not streamed
+  if (stream && db.settings.hasPages()) {
+    std::cerr << "The streaming export does not support the pages\n";
+    return EXIT_FAILURE;
   }
 
-  // generate colors
+  // generate pixels
 
-  std::cout << "Computing colors (1/4)...\n";
+  std::cout << "Seed: " << options.seed << '\n';
 
-  for (auto& tileset : plain) {
-    for (auto& tile : tileset) {
-      tile.colorize(db.biomes, random);
+  if (stream) {
+    if (!generator.stream(std::move(db))) {
+      return EXIT_FAILURE;
     }
-  }
-
-  std::cout << "Computing colors (2/4)...\n";
-
-  for (auto& tileset : wang2) {
-    for (auto& tile : tileset) {
-      tile.colorize(db.biomes, random);
+  } else {
+    if (generator.generate(std::move(db)) == 0 || !generator.writeFiles()) {
+      return EXIT_FAILURE;
     }
   }
 
-  std::cout << "Computing colors (3/4)...\n";
-
-  for (auto& tileset : wang3) {
-    for (auto& tile : tileset) {
-      tile.colorize(db.biomes, random);
-    }
+  if (generator.hasCache()) {
+    auto stats = generator.getCacheStats();
+    std::cout << "Cache: " << stats.hits << " hits, " << stats.misses << " misses\n";
   }
 
-  std::cout << "Computing colors (4/4)...\n";
+  auto scratch = tlgn::Scratch::getStats();
+  std::cout << "Scratch allocations: " << scratch.allocations << " for " << scratch.tiles << " tiles\n";
 
-  for (auto& tileset : overlays) {
-    for (auto& tile : tileset) {
-      tile.colorize(db.biomes, random);
+  // in watch mode, the profile is written again after each update, with the updates so far
+  auto writeProfile = [&statsFile, &traceFile]() {
+    if (!statsFile.empty()) {
+      tlgn::Profiler::get().writeStats(statsFile);
     }
-  }
-
-  // generate files
-
-  std::cout << "Computing biome image...\n";
 
-  tlgn::Colors image(db.settings.image);
-
-  tlgn::ImageContext ctx;
-  tlgn::exportTilesetsToImage(plain, db.settings, image, ctx);
-  tlgn::exportTilesetsToImage(wang2, db.settings, image, ctx);
-  tlgn::exportTilesetsToImage(wang3, db.settings, image, ctx);
-  tlgn::exportTilesetsToImage(overlays, db.settings, image, ctx);
-
-  std::cout << "Generating biome image...\n";
-  tlgn::exportImageToFile(image, "biomes.png");
-
-  tlgn::Terrains terrains;
-  tlgn::exportTilesetsToTerrains(plain, db, terrains);
-  tlgn::exportTilesetsToTerrains(wang2, db, terrains);
-  tlgn::exportTilesetsToTerrains(wang3, db, terrains);
-  tlgn::exportTilesetsToTerrains(overlays, db, terrains);
+    if (!traceFile.empty()) {
+      tlgn::Profiler::get().writeTrace(traceFile);
+    }
+  };
 
-  std::cout << "Generating biome tileset...\n";
+  writeProfile();
 
-  {
-    std::ofstream tileset("biomes.tsx");
-    tlgn::exportTerrainsToFile(terrains, db, tileset);
+  if (watch && !tlgn::watchDatabase(filename, tlgn::getPipeline(generator), writeProfile)) {
+    return EXIT_FAILURE;
   }
 
   return EXIT_SUCCESS;
@@ -0,0 +1,518 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gf/Id.h>
+
+#include "Database.h"
+#include "Export.h"
+#include "Fill.h"
+#include "Line.h"
+#include "Plan.h"
+#include "Png.h"
+#include "Seed.h"
+#include "ThreadPool.h"
+#include "Tile.h"
+#include "TileProvider.h"
+#include "Tileset.h"
+
+namespace {
+
+  constexpr tlgn::PaletteIndex Biome1 = 0;
+  constexpr tlgn::PaletteIndex Biome2 = 1;
+
+  constexpr uint64_t BenchSeed = 42;
+  constexpr int ExportTilesetCount = 16;
+  const char *BenchImage = "tilegen_bench.png";
+
+  struct Options {
+    double minTime = 0.1;
+    int maxSize = 256;
+    unsigned maxThreads = tlgn::ThreadPool::getDefaultJobs();
+    std::string filter;
+    std::string json;
+  };
+
+  struct Result {
+    std::string name;
+    int size;
+    unsigned threads;
+    long iterations;
+    double nanoseconds; // per operation
+  };
+
+  /*
+   * Runs an operation until the minimum time is reached, doubling the number
+   * of iterations each round, and reports the time of one operation.
+   */
+  class Bench {
+  public:
+    explicit Bench(const Options& options)
+    : m_options(options)
+    {
+      std::cout << std::left << std::setw(32) << "benchmark" << std::right << std::setw(6) << "size" << std::setw(9) << "threads" << std::setw(12) << "iterations" << std::setw(16) << "ns/op" << '\n';
+    }
+
+    bool isSelected(const std::string& name) const {
+      return m_options.filter.empty() || name.find(m_options.filter) != std::string::npos;
+    }
+
+    template<typename Func>
+    void run(const std::string& name, int size, unsigned threads, Func func) {
+      if (!isSelected(name)) {
+        return;
+      }
+
+      using Clock = std::chrono::steady_clock;
+
+      func(); // warm up
+
+      long iterations = 1;
+      double elapsed = 0.0;
+
+      for (;;) {
+        auto start = Clock::now();
+
+        for (long i = 0; i < iterations; ++i) {
+          func();
+        }
+
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (elapsed >= m_options.minTime || iterations >= (1L << 30)) {
+          break;
+        }
+
+        iterations *= 2;
+      }
+
+      Result result = { name, size, threads, iterations, elapsed * 1e9 / iterations };
+      m_results.push_back(result);
+
+      std::cout << std::left << std::setw(32) << result.name << std::right << std::setw(6) << result.size << std::setw(9) << result.threads << std::setw(12) << result.iterations;
+      std::cout << std::fixed << std::setprecision(0) << std::setw(16) << result.nanoseconds << std::endl;
+    }
+
+    bool writeJson(const std::string& filename) const {
+      std::ofstream os(filename);
+
+      if (!os) {
+        std::cerr << "Could not open the result file: " << filename << '\n';
+        return false;
+      }
+
+      os << "{\n  \"min_time\": " << m_options.minTime << ",\n  \"benchmarks\": [\n";
+
+      for (std::size_t i = 0; i < m_results.size(); ++i) {
+        auto& result = m_results[i];
+        os << "    { \"name\": \"" << result.name << "\", \"size\": " << result.size << ", \"threads\": " << result.threads;
+        os << ", \"iterations\": " << result.iterations << ", \"ns_per_op\": " << std::fixed << std::setprecision(1) << result.nanoseconds << " }";
+        os << (i + 1 < m_results.size() ? ",\n" : "\n");
+      }
+
+      os << "  ]\n}\n";
+      return static_cast<bool>(os);
+    }
+
+  private:
+    const Options& m_options;
+    std::vector<Result> m_results;
+  };
+
+  /*
+   * Fill
+   */
+
+  // the previous breadth-first fill, kept as a reference
+  void referenceFillBiomeFrom(tlgn::Pixels& pixels, gf::Vector2i pos, tlgn::PaletteIndex biome) {
+    pixels(pos) = biome;
+
+    std::queue<gf::Vector2i> q;
+    q.push(pos);
+
+    while (!q.empty()) {
+      auto curr = q.front();
+
+      for (auto next : pixels.get4NeighborsRange(curr)) {
+        if (pixels(next) == tlgn::InvalidIndex) {
+          pixels(next) = biome;
+          q.push(next);
+        }
+      }
+
+      q.pop();
+    }
+  }
+
+  // a wavy frontier from the top edge to the left edge, like a corner tile
+  tlgn::Pixels makeFrontier(int size) {
+    tlgn::Pixels pixels({ size, size }, tlgn::InvalidIndex);
+
+    for (int i = 0; i < size; ++i) {
+      int j = size - 1 - i + static_cast<int>(std::lround(size / 8.0 * std::sin(i * 12.0 / size)));
+
+      if (j >= 0 && j < size) {
+        pixels({ i, j }) = Biome1;
+      }
+    }
+
+    return pixels;
+  }
+
+  template<typename Func>
+  void fillBoth(const tlgn::Pixels& model, Func func, tlgn::Pixels& result) {
+    auto size = model.getSize();
+    result = model;
+    func(result, { 0, 0 }, Biome1);
+    func(result, { size.width - 1, size.height - 1 }, Biome2);
+  }
+
+  bool benchFill(Bench& bench, int size) {
+    auto model = makeFrontier(size);
+
+    tlgn::Pixels expected;
+    fillBoth(model, referenceFillBiomeFrom, expected);
+
+    tlgn::Pixels actual;
+    fillBoth(model, tlgn::fillBiomeFrom, actual);
+
+    if (!std::equal(expected.begin(), expected.end(), actual.begin())) {
+      std::cerr << "Mismatch between the fills for size " << size << '\n';
+      return false;
+    }
+
+    bench.run("fill/queue", size, 1, [&]() { fillBoth(model, referenceFillBiomeFrom, actual); });
+    bench.run("fill/scanline", size, 1, [&]() { fillBoth(model, tlgn::fillBiomeFrom, actual); });
+    return true;
+  }
+
+  /*
+   * Line
+   */
+
+  // the frontiers of the generators: from an edge to the next one for a corner, across the tile for a split
+  void benchLine(Bench& bench, int size) {
+    tlgn::TileSettings settings;
+    settings.size = size;
+    settings.spacing = 1;
+
+    const int half = size / 2;
+    const gf::Vector2i corner[2] = { { half - 1, 0 }, { 0, half - 1 } };
+    const gf::Vector2i split[2] = { { 0, half }, { size - 1, half } };
+
+    tlgn::Pixels pixels({ size, size }, tlgn::InvalidIndex);
+    gf::Random random(BenchSeed);
+
+    bench.run("line/corner", size, 1, [&]() { tlgn::drawLine(pixels, settings, corner, random, Biome1); });
+    bench.run("line/split", size, 1, [&]() { tlgn::drawLine(pixels, settings, split, random, Biome1); });
+  }
+
+  /*
+   * Database
+   */
+
+  const gf::Id PlainBiome = gf::hash("plain");
+  const gf::Id RandomizeBiome = gf::hash("randomize");
+  const gf::Id StripedBiome = gf::hash("striped");
+
+  void addBiome(tlgn::Database& db, const std::string& name, tlgn::PigmentStyle style, gf::Color4f color) {
+    tlgn::Biome biome;
+    biome.id = gf::hash(name);
+    biome.name = name;
+    biome.index = static_cast<int>(db.biomes.size());
+    biome.pigment.color = color;
+    biome.pigment.style = style;
+
+    if (style == tlgn::PigmentStyle::Randomize) {
+      biome.pigment.randomize.ratio = 0.2;
+      biome.pigment.randomize.deviation = 0.1f;
+    }
+
+    db.biomes.insert({ biome.id, biome });
+  }
+
+  // three biomes, one of each style, all the frontiers with the same border effect
+  tlgn::Database makeDatabase(int size, tlgn::BorderEffect effect) {
+    tlgn::Database db;
+    db.settings.name = "bench";
+    db.settings.tile.size = size;
+    db.settings.tile.spacing = 1;
+    db.settings.image = { 9 * db.settings.tile.getExtendedSize(), 4 * ExportTilesetCount * db.settings.tile.getExtendedSize() };
+
+    addBiome(db, "plain", tlgn::PigmentStyle::Plain, { 0.2f, 0.6f, 0.2f, 1.0f });
+    addBiome(db, "randomize", tlgn::PigmentStyle::Randomize, { 0.8f, 0.7f, 0.4f, 1.0f });
+    addBiome(db, "striped", tlgn::PigmentStyle::Striped, { 0.1f, 0.3f, 0.8f, 1.0f });
+
+    auto addDuo = [&](gf::Id b1, gf::Id b2) {
+      tlgn::BiomeDuo duo;
+      duo.b1 = b1;
+      duo.b2 = b2;
+      duo.frontier.border.effect = effect;
+      duo.frontier.border.b1 = b1;
+      duo.frontier.border.b2 = b2;
+      duo.frontier.fence = true;
+      db.duos.push_back(duo);
+    };
+
+    addDuo(PlainBiome, RandomizeBiome);
+    addDuo(RandomizeBiome, StripedBiome);
+    addDuo(StripedBiome, PlainBiome);
+
+    db.trios.push_back({ PlainBiome, RandomizeBiome, StripedBiome });
+
+    tlgn::BiomeOverlay overlay;
+    overlay.b0 = PlainBiome;
+    overlay.frontier.border.effect = effect;
+    overlay.frontier.border.b1 = PlainBiome;
+    overlay.frontier.border.b2 = tlgn::Void;
+    db.overlays.push_back(overlay);
+
+    db.compile();
+    return db;
+  }
+
+  /*
+   * Geometry and colors
+   */
+
+  void benchGenerate(Bench& bench, int size) {
+    auto db = makeDatabase(size, tlgn::BorderEffect::None);
+
+    tlgn::TilesetSeed two = { BenchSeed, tlgn::SeedCategory::TwoCorners, 0 };
+    tlgn::TilesetSeed three = { BenchSeed, tlgn::SeedCategory::ThreeCorners, 0 };
+    tlgn::Tileset tileset;
+
+    bench.run("generate/plain", size, 1, [&]() { tileset = tlgn::generatePlainTileset(PlainBiome, db); });
+    bench.run("generate/two_corners", size, 1, [&]() { tileset = tlgn::generateTwoCornersWangTileset(PlainBiome, RandomizeBiome, two, db); });
+    bench.run("generate/three_corners", size, 1, [&]() { tileset = tlgn::generateThreeCornersWangTileset(PlainBiome, RandomizeBiome, StripedBiome, three, db); });
+
+    tlgn::Tile tile = tlgn::generateTwoCornersWangTileset(PlainBiome, RandomizeBiome, two, db)({ 1, 1 });
+    bench.run("tile/rotate", size, 1, [&]() { tile.rotate(1); });
+  }
+
+  // the generator of a single tile is chosen from its corners, in the order top-left, top-right, bottom-left, bottom-right
+  void benchGenerators(Bench& bench, int size) {
+    static const std::pair<std::array<gf::Id, 4>, const char *> Generators[] = {
+      { { PlainBiome, PlainBiome, PlainBiome, RandomizeBiome }, "generate/corner" },
+      { { PlainBiome, PlainBiome, RandomizeBiome, RandomizeBiome }, "generate/split" },
+      { { PlainBiome, RandomizeBiome, RandomizeBiome, PlainBiome }, "generate/cross" },
+      { { PlainBiome, PlainBiome, RandomizeBiome, StripedBiome }, "generate/211" },
+      { { PlainBiome, RandomizeBiome, StripedBiome, PlainBiome }, "generate/211_cross" },
+    };
+
+    auto db = makeDatabase(size, tlgn::BorderEffect::None);
+    gf::Random random(BenchSeed);
+    tlgn::Tile tile(gf::None);
+
+    for (auto& generator : Generators) {
+      bench.run(generator.second, size, 1, [&]() { tlgn::generateTile(generator.first, random, db, tile); });
+    }
+  }
+
+  // the copy of the tile is part of the operation, colorize consumes the float colors
+  void benchColorize(Bench& bench, const std::string& name, const tlgn::Tile& model, const tlgn::Database& db, int size) {
+    tlgn::Tile tile(gf::None);
+
+    bench.run(name, size, 1, [&]() {
+      gf::Random random(BenchSeed);
+      tile = model;
+      tile.colorize(db, random);
+    });
+  }
+
+  void benchColorizeStyles(Bench& bench, int size) {
+    auto db = makeDatabase(size, tlgn::BorderEffect::None);
+
+    benchColorize(bench, "colorize/plain", tlgn::generatePlainTileset(PlainBiome, db)({ 0, 0 }), db, size);
+    benchColorize(bench, "colorize/randomize", tlgn::generatePlainTileset(RandomizeBiome, db)({ 0, 0 }), db, size);
+    benchColorize(bench, "colorize/striped", tlgn::generatePlainTileset(StripedBiome, db)({ 0, 0 }), db, size);
+  }
+
+  void benchColorizeBorders(Bench& bench, int size) {
+    static const std::pair<tlgn::BorderEffect, const char *> Effects[] = {
+      { tlgn::BorderEffect::None, "colorize/border/none" },
+      { tlgn::BorderEffect::Fade, "colorize/border/fade" },
+      { tlgn::BorderEffect::Outline, "colorize/border/outline" },
+      { tlgn::BorderEffect::Sharpen, "colorize/border/sharpen" },
+      { tlgn::BorderEffect::Blur, "colorize/border/blur" },
+    };
+
+    for (auto& effect : Effects) {
+      if (!bench.isSelected(effect.second)) {
+        continue;
+      }
+
+      auto db = makeDatabase(size, effect.first);
+      tlgn::TilesetSeed seed = { BenchSeed, tlgn::SeedCategory::TwoCorners, 0 };
+      auto tileset = tlgn::generateTwoCornersWangTileset(PlainBiome, RandomizeBiome, seed, db);
+
+      // a split tile, with the frontier across the whole tile
+      benchColorize(bench, effect.second, tileset({ 1, 0 }), db, size);
+    }
+  }
+
+  // a three corners tile with blurred borders, generated each time or taken from the cache
+  void benchProvider(Bench& bench, int size) {
+    tlgn::TileProvider provider(makeDatabase(size, tlgn::BorderEffect::Blur), BenchSeed, 64);
+    std::array<gf::Id, 4> terrain = { PlainBiome, RandomizeBiome, StripedBiome, PlainBiome };
+    uint64_t variant = 0;
+
+    bench.run("provider/miss", size, 1, [&]() { provider.getTile(terrain, ++variant); });
+    bench.run("provider/hit", size, 1, [&]() { provider.getTile(terrain, 0); });
+  }
+
+  /*
+   * Pipeline and export
+   */
+
+  std::vector<tlgn::TilesetPlan> makePlans(const tlgn::Database& db) {
+    auto plans = tlgn::planTilesets(tlgn::SeedCategory::TwoCorners, BenchSeed, db);
+    auto trios = tlgn::planTilesets(tlgn::SeedCategory::ThreeCorners, BenchSeed, db);
+    plans.insert(plans.end(), trios.begin(), trios.end());
+
+    while (plans.size() < ExportTilesetCount) {
+      plans.push_back(plans[plans.size() % 4]);
+      plans.back().seed.index = plans.size();
+    }
+
+    return plans;
+  }
+
+  void benchTilesets(Bench& bench, int size, unsigned threads) {
+    auto db = makeDatabase(size, tlgn::BorderEffect::Blur);
+    auto plans = makePlans(db);
+
+    tlgn::ThreadPool pool(threads);
+    std::vector<tlgn::Tileset> tilesets(plans.size());
+
+    bench.run("pipeline/tilesets", size, threads, [&]() {
+      pool.parallelFor(plans.size(), [&](std::size_t i) {
+        tilesets[i] = tlgn::computeTileset(plans[i], db);
+      });
+    });
+  }
+
+  void benchExport(Bench& bench, int size, const std::vector<unsigned>& threadCounts) {
+    auto db = makeDatabase(size, tlgn::BorderEffect::Blur);
+
+    // only two corners tilesets, so that they all have the same size
+    std::vector<tlgn::Tileset> tilesets;
+
+    for (auto& plan : tlgn::planTilesets(tlgn::SeedCategory::TwoCorners, BenchSeed, db)) {
+      tilesets.push_back(tlgn::computeTileset(plan, db));
+    }
+
+    while (tilesets.size() < ExportTilesetCount) {
+      tilesets.push_back(tilesets[tilesets.size() % 3]);
+    }
+
+    tlgn::Texels image(db.settings.image);
+
+    // gives their ids to the tiles
+    tlgn::ImageContext layout;
+    tlgn::exportTilesetsToImage(tilesets, db.settings, image, layout);
+
+    bench.run("export/image", size, 1, [&]() {
+      tlgn::ImageContext ctx;
+      tlgn::exportTilesetsToImage(tilesets, db.settings, image, ctx);
+    });
+
+    for (auto threads : threadCounts) {
+      if (!bench.isSelected("export/png")) {
+        break;
+      }
+
+      tlgn::ThreadPool pool(threads);
+      bench.run("export/png/level1", size, threads, [&]() { tlgn::writePng(image, BenchImage, 1, pool); });
+      bench.run("export/png/level6", size, threads, [&]() { tlgn::writePng(image, BenchImage, tlgn::DefaultPngLevel, pool); });
+    }
+
+    std::remove(BenchImage);
+
+    tlgn::Terrains terrains;
+    tlgn::exportTilesetsToTerrains(tilesets, db, terrains);
+
+    bench.run("export/tsx", size, 1, [&]() {
+      std::ostringstream os;
+      tlgn::exportTerrainsToFile(terrains, db, os);
+    });
+  }
+
+  void printUsage() {
+    std::cout << "Usage: tilegen_bench [--json <file>] [--filter <text>] [--min-time <seconds>] [--max-size <n>] [--max-threads <n>]\n";
+  }
+
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+
+  // the conversions throw on an invalid number
+  try {
+    for (int i = 1; i < argc; ++i) {
+      if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+        options.json = argv[++i];
+      } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+        options.filter = argv[++i];
+      } else if (std::strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+        options.minTime = std::stod(argv[++i]);
+      } else if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) {
+        options.maxSize = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+        options.maxThreads = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+      } else {
+        printUsage();
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (const std::logic_error&) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  std::vector<unsigned> threadCounts;
+
+  for (unsigned threads = 1; threads < options.maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+
+  threadCounts.push_back(options.maxThreads);
+
+  Bench bench(options);
+  bool ok = true;
+
+  for (int size = 16; size <= options.maxSize; size *= 2) {
+    ok = benchFill(bench, size) && ok;
+    benchLine(bench, size);
+    benchGenerate(bench, size);
+    benchGenerators(bench, size);
+    benchColorizeStyles(bench, size);
+    benchColorizeBorders(bench, size);
+    benchProvider(bench, size);
+
+    for (auto threads : threadCounts) {
+      benchTilesets(bench, size, threads);
+    }
+
+    benchExport(bench, size, threadCounts);
+  }
+
+  if (!options.json.empty() && !bench.writeJson(options.json)) {
+    ok = false;
+  }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
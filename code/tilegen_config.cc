@@ -0,0 +1,349 @@
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gf/Random.h>
+#include <gf/VectorOps.h>
+
+#include "Seed.h"
+#include "Tileset.h"
+
+namespace {
+
+  const char *PigmentStyles[] = { "plain", "randomize", "striped" };
+  const char *BorderEffects[] = { "none", "fade", "outline", "sharpen", "blur" };
+  const char *DistanceMetrics[] = { "manhattan", "euclidean" };
+
+  struct Options {
+    std::string name = "synthetic";
+    int biomes = 8;
+    double duos = 1.0; // fraction of all the pairs
+    int trios = 0;
+    int overlays = 0;
+    std::vector<std::string> styles = { "plain", "randomize", "striped" };
+    std::vector<std::string> effects = { "none", "fade", "outline", "sharpen", "blur" };
+    std::vector<std::string> metrics = { "manhattan" };
+    double fences = 0.0; // probability of a fence
+    int tileSize = 32;
+    int spacing = 1;
+    int pageSize = 0; // no pages
+    uint64_t seed = 42;
+    std::string output;
+  };
+
+  void printUsage() {
+    std::cout << "Usage: tilegen_config [--biomes <n>] [--duos <ratio>] [--trios <n>] [--overlays <n>] [--styles <list>] [--effects <list>] [--metrics <list>] [--fences <ratio>] [--tile-size <n>] [--spacing <n>] [--page-size <n>] [--seed <n>] [--name <name>] [--output <file>]\n";
+  }
+
+  template<std::size_t N>
+  bool parseList(const char *arg, std::vector<std::string>& list, const char *(&known)[N]) {
+    list.clear();
+
+    std::istringstream is(arg);
+    std::string item;
+
+    while (std::getline(is, item, ',')) {
+      if (std::find(std::begin(known), std::end(known), item) == std::end(known)) {
+        std::cerr << "Unknown value: " << item << '\n';
+        return false;
+      }
+
+      list.push_back(item);
+    }
+
+    return !list.empty();
+  }
+
+  template<typename T>
+  const T& pick(gf::Random& random, const std::vector<T>& values) {
+    return values[random.computeUniformInteger<std::size_t>(0, values.size() - 1)];
+  }
+
+  std::string getBiomeName(int biome) {
+    return "biome" + std::to_string(biome);
+  }
+
+  /*
+   * Computes the size of the atlas, following the layout of the export: the
+   * categories are written one after the other, each one starting on a new
+   * row of tilesets. The width is a multiple of the width of all the
+   * tilesets so that no column is lost.
+   */
+  gf::Vector2i computeImageSize(const Options& options, const std::size_t counts[4]) {
+    constexpr tlgn::SeedCategory Categories[] = {
+      tlgn::SeedCategory::Plain,
+      tlgn::SeedCategory::TwoCorners,
+      tlgn::SeedCategory::ThreeCorners,
+      tlgn::SeedCategory::Overlay,
+    };
+
+    const int extendedSize = options.tileSize + 2 * options.spacing;
+    const int step = 36; // lcm of the tileset widths
+
+    std::size_t tiles = 0;
+
+    for (std::size_t i = 0; i < 4; ++i) {
+      gf::Vector2i tilesetSize = tlgn::getTilesetSize(Categories[i]);
+      tiles += counts[i] * tilesetSize.width * tilesetSize.height;
+    }
+
+    int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(std::max<std::size_t>(tiles, 1)))));
+    columns = (columns + step - 1) / step * step;
+
+    int rows = 0;
+
+    for (std::size_t i = 0; i < 4; ++i) {
+      if (counts[i] == 0) {
+        continue;
+      }
+
+      gf::Vector2i tilesetSize = tlgn::getTilesetSize(Categories[i]);
+      std::size_t tilesetsPerRow = columns / tilesetSize.width;
+      rows += static_cast<int>((counts[i] - 1) / tilesetsPerRow + 1) * tilesetSize.height;
+    }
+
+    return { columns * extendedSize, std::max(rows, 1) * extendedSize };
+  }
+
+  class ConfigWriter {
+  public:
+    ConfigWriter(const Options& options, gf::Random& random)
+    : m_options(options)
+    , m_random(random)
+    {
+    }
+
+    void write(std::ostream& os) {
+      generate();
+
+      std::size_t counts[4] = { static_cast<std::size_t>(m_options.biomes), m_duos.size(), m_trios.size(), m_overlays.size() };
+      gf::Vector2i image = computeImageSize(m_options, counts);
+
+      os << "{\n";
+      os << "  \"settings\": { \"name\": \"" << m_options.name << "\", \"tile\": { \"size\": " << m_options.tileSize << ", \"spacing\": " << m_options.spacing << " }, \"image\": [ " << image.width << ", " << image.height << " ]";
+
+      if (m_options.pageSize > 0) {
+        os << ", \"page\": [ " << m_options.pageSize << ", " << m_options.pageSize << " ]";
+      }
+
+      os << " },\n";
+
+      os << "  \"biomes\": {\n";
+
+      for (int i = 0; i < m_options.biomes; ++i) {
+        os << "    \"" << i << "\": { \"id\": \"" << getBiomeName(i) << "\", \"color\": [ ";
+
+        for (int c = 0; c < 3; ++c) {
+          os << m_random.computeUniformInteger(0, 255) << ", ";
+        }
+
+        const std::string& style = pick(m_random, m_options.styles);
+        os << "255 ], \"pigment\": { \"style\": \"" << style << "\"";
+
+        if (style == "randomize") {
+          os << ", \"ratio\": " << m_random.computeUniformFloat(0.05, 0.5) << ", \"deviation\": " << m_random.computeUniformFloat(0.05, 0.3);
+        }
+
+        os << " } }" << (i + 1 < m_options.biomes ? "," : "") << '\n';
+      }
+
+      os << "  },\n";
+
+      os << "  \"duos\": [\n";
+
+      for (std::size_t i = 0; i < m_duos.size(); ++i) {
+        os << "    { \"biomes\": [ \"" << getBiomeName(m_duos[i].first) << "\", \"" << getBiomeName(m_duos[i].second) << "\" ], ";
+        writeFrontier(os);
+        os << " }" << (i + 1 < m_duos.size() ? "," : "") << '\n';
+      }
+
+      os << "  ],\n";
+
+      os << "  \"trios\": [\n";
+
+      for (std::size_t i = 0; i < m_trios.size(); ++i) {
+        os << "    [ \"" << getBiomeName(std::get<0>(m_trios[i])) << "\", \"" << getBiomeName(std::get<1>(m_trios[i])) << "\", \"" << getBiomeName(std::get<2>(m_trios[i])) << "\" ]" << (i + 1 < m_trios.size() ? "," : "") << '\n';
+      }
+
+      os << "  ],\n";
+
+      os << "  \"overlays\": [\n";
+
+      for (std::size_t i = 0; i < m_overlays.size(); ++i) {
+        os << "    { \"biome\": \"" << getBiomeName(m_overlays[i]) << "\", ";
+        writeFrontier(os);
+        os << " }" << (i + 1 < m_overlays.size() ? "," : "") << '\n';
+      }
+
+      os << "  ]\n";
+      os << "}\n";
+
+      std::cerr << "Generated " << m_options.biomes << " biomes, " << m_duos.size() << " duos, " << m_trios.size() << " trios, " << m_overlays.size() << " overlays in a " << image.width << 'x' << image.height << " image\n";
+    }
+
+  private:
+    void generate() {
+      const int n = m_options.biomes;
+
+      for (int i = 0; i < n; ++i) {
+        for (int j = i + 1; j < n; ++j) {
+          if (m_options.duos >= 1.0 || m_random.computeBernoulli(m_options.duos)) {
+            m_duos.emplace_back(i, j);
+          }
+        }
+      }
+
+      // the biomes of a trio are distinct and a trio is not repeated
+      std::set<std::tuple<int, int, int>> trios;
+      long possible = static_cast<long>(n) * (n - 1) * (n - 2) / 6;
+      int count = static_cast<int>(std::min<long>(m_options.trios, possible));
+
+      while (static_cast<int>(m_trios.size()) < count) {
+        int b[3];
+
+        do {
+          b[0] = m_random.computeUniformInteger(0, n - 1);
+          b[1] = m_random.computeUniformInteger(0, n - 1);
+          b[2] = m_random.computeUniformInteger(0, n - 1);
+        } while (b[0] == b[1] || b[1] == b[2] || b[2] == b[0]);
+
+        int sorted[3] = { b[0], b[1], b[2] };
+        std::sort(std::begin(sorted), std::end(sorted));
+
+        if (trios.insert(std::make_tuple(sorted[0], sorted[1], sorted[2])).second) {
+          m_trios.emplace_back(b[0], b[1], b[2]);
+        }
+      }
+
+      std::vector<int> overlays(n);
+
+      for (int i = 0; i < n; ++i) {
+        overlays[i] = i;
+      }
+
+      // partial Fisher-Yates shuffle
+      count = std::min(m_options.overlays, n);
+
+      for (int i = 0; i < count; ++i) {
+        std::swap(overlays[i], overlays[m_random.computeUniformInteger(i, n - 1)]);
+      }
+
+      m_overlays.assign(overlays.begin(), overlays.begin() + count);
+    }
+
+    void writeFrontier(std::ostream& os) {
+      int maxOffset = std::min(2, m_options.tileSize / 8);
+      os << "\"offset\": " << m_random.computeUniformInteger(-maxOffset, maxOffset);
+
+      const std::string& effect = pick(m_random, m_options.effects);
+
+      if (effect != "none") {
+        os << ", \"border\": { \"effect\": \"" << effect << "\", \"metric\": \"" << pick(m_random, m_options.metrics) << "\" }";
+      }
+
+      if (m_options.fences > 0.0 && m_random.computeBernoulli(m_options.fences)) {
+        os << ", \"fence\": true";
+      }
+    }
+
+  private:
+    const Options& m_options;
+    gf::Random& m_random;
+    std::vector<std::pair<int, int>> m_duos;
+    std::vector<std::tuple<int, int, int>> m_trios;
+    std::vector<int> m_overlays;
+  };
+
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+
+  // the conversions throw on an invalid number
+  try {
+    for (int i = 1; i < argc; ++i) {
+      if (std::strcmp(argv[i], "--biomes") == 0 && i + 1 < argc) {
+        options.biomes = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--duos") == 0 && i + 1 < argc) {
+        options.duos = std::stod(argv[++i]);
+      } else if (std::strcmp(argv[i], "--trios") == 0 && i + 1 < argc) {
+        options.trios = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--overlays") == 0 && i + 1 < argc) {
+        options.overlays = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--styles") == 0 && i + 1 < argc) {
+        if (!parseList(argv[++i], options.styles, PigmentStyles)) {
+          return EXIT_FAILURE;
+        }
+      } else if (std::strcmp(argv[i], "--effects") == 0 && i + 1 < argc) {
+        if (!parseList(argv[++i], options.effects, BorderEffects)) {
+          return EXIT_FAILURE;
+        }
+      } else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+        if (!parseList(argv[++i], options.metrics, DistanceMetrics)) {
+          return EXIT_FAILURE;
+        }
+      } else if (std::strcmp(argv[i], "--fences") == 0 && i + 1 < argc) {
+        options.fences = std::stod(argv[++i]);
+      } else if (std::strcmp(argv[i], "--tile-size") == 0 && i + 1 < argc) {
+        options.tileSize = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--spacing") == 0 && i + 1 < argc) {
+        options.spacing = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--page-size") == 0 && i + 1 < argc) {
+        options.pageSize = std::stoi(argv[++i]);
+      } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+        options.seed = std::stoull(argv[++i]);
+      } else if (std::strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+        options.name = argv[++i];
+      } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+        options.output = argv[++i];
+      } else {
+        printUsage();
+        return EXIT_FAILURE;
+      }
+    }
+  } catch (const std::logic_error&) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  if (options.biomes < 1 || options.duos < 0.0 || options.duos > 1.0 || options.trios < 0 || options.overlays < 0 || options.fences < 0.0 || options.fences > 1.0 || options.tileSize < 8 || options.tileSize % 2 != 0 || options.spacing < 0 || options.pageSize < 0) {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  // a page must hold the largest tileset, 9x4 tiles
+  gf::Vector2i largest = tlgn::getTilesetSize(tlgn::SeedCategory::ThreeCorners) * (options.tileSize + 2 * options.spacing);
+
+  if (options.pageSize > 0 && (options.pageSize < largest.width || options.pageSize < largest.height)) {
+    std::cerr << "The page size must be at least " << std::max(largest.width, largest.height) << '\n';
+    return EXIT_FAILURE;
+  }
+
+  gf::Random random(options.seed);
+  ConfigWriter writer(options, random);
+
+  if (options.output.empty()) {
+    writer.write(std::cout);
+    return EXIT_SUCCESS;
+  }
+
+  std::ofstream os(options.output);
+
+  if (!os) {
+    std::cerr << "Could not open the output file: " << options.output << '\n';
+    return EXIT_FAILURE;
+  }
+
+  writer.write(os);
+  return EXIT_SUCCESS;
+}